@@ -2,16 +2,27 @@
 #define ECHO_SERVER_H
 
 #include "client_handler.h"
+#include "buffer_pool.h"
 #include <netinet/in.h>
 
 #define ECHO_PORT 9999
 #define MAX_CLIENTS 1024
-#define TIMEOUT_SECS 5
+#define TIMEOUT_SECS 1
 
 typedef struct {
     int server_sock;
     struct sockaddr_in server_addr;
-    client_t clients[MAX_CLIENTS];
+    client_t *clients;             // 连接表，大页模式下位于大页区域
+    mem_region_t clients_region;
+    BufferPool *rx_pool;           // 接收缓冲池
+    BufferPool *tx_pool;           // 发送缓冲池
+    FileCache *file_cache;         // 静态文件缓存
+    OpenFileCache *open_files;     // 打开文件描述符缓存
+    FileCache *gzip_cache;         // 动态压缩变体缓存
+    PackImage *pack;               // 文档根目录的 pack 映像，未配置时为 NULL
+    Prefetcher *prefetch;          // 冷文件的后台预读，禁用时为 NULL
+    FingerprintIndex *fingerprints; // 带内容哈希的路径索引
+    VhostTable *vhosts;            // 按 Host 头选择的站点，默认站点为 file_cache
     int is_running;
 } server_t;
 
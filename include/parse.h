@@ -45,4 +45,8 @@ int yyparse();
 void set_parsing_options(char *buf, size_t i, Request *request);
 void free_request(Request *request);
 
+// helpers implemented in parse.c
+const char *request_get_header(const Request *request, const char *name);
+int header_has_token(const char *value, const char *token);
+
 #endif
\ No newline at end of file
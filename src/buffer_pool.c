@@ -0,0 +1,224 @@
+#include "buffer_pool.h"
+#include "logger.h"
+#include <string.h>
+#include <errno.h>
+#include <stdint.h>
+#include <sys/mman.h>
+
+// 各分配方式的成功次数及回退次数
+static size_t region_mode_counts[3];
+static size_t hugetlb_fallbacks;
+static size_t thp_fallbacks;
+
+static const char* region_mode_names[] = {
+    "heap",
+    "hugetlb",
+    "thp"
+};
+
+const char* mem_region_mode_name(region_mode_t mode) {
+    return region_mode_names[mode];
+}
+
+static size_t round_up(size_t size, size_t align) {
+    return (size + align - 1) & ~(align - 1);
+}
+
+// 映射按 2MB 对齐的匿名内存并建议内核使用透明大页
+static void* map_thp(size_t size) {
+    size_t map_size = size + HUGE_PAGE_SIZE;
+    char* raw = mmap(NULL, map_size, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (raw == MAP_FAILED) {
+        return NULL;
+    }
+
+    // 裁掉首尾未对齐的部分
+    char* aligned = (char*)round_up((uintptr_t)raw, HUGE_PAGE_SIZE);
+    size_t head = aligned - raw;
+    size_t tail = map_size - head - size;
+    if (head > 0) {
+        munmap(raw, head);
+    }
+    if (tail > 0) {
+        munmap(aligned + size, tail);
+    }
+
+#ifdef MADV_HUGEPAGE
+    if (madvise(aligned, size, MADV_HUGEPAGE) != 0) {
+        LOG_WARN("madvise(MADV_HUGEPAGE) failed: %s", strerror(errno));
+    }
+#endif
+    return aligned;
+}
+
+int mem_region_alloc(mem_region_t* region, size_t size, bool hugepages, mem_tag_t tag) {
+    memset(region, 0, sizeof(*region));
+    region->tag = tag;
+
+    if (hugepages) {
+        size_t huge_size = round_up(size, HUGE_PAGE_SIZE);
+
+#ifdef MAP_HUGETLB
+        void* base = mmap(NULL, huge_size, PROT_READ | PROT_WRITE,
+                          MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (base != MAP_FAILED) {
+            region->base = base;
+            region->size = huge_size;
+            region->mode = REGION_MODE_HUGETLB;
+            region_mode_counts[REGION_MODE_HUGETLB]++;
+            return 0;
+        }
+        LOG_WARN("MAP_HUGETLB failed (%s), falling back to transparent huge pages", strerror(errno));
+#endif
+        hugetlb_fallbacks++;
+
+        region->base = map_thp(huge_size);
+        if (region->base) {
+            region->size = huge_size;
+            region->mode = REGION_MODE_THP;
+            region_mode_counts[REGION_MODE_THP]++;
+            return 0;
+        }
+        LOG_WARN("Transparent huge page mapping failed (%s), falling back to heap", strerror(errno));
+        thp_fallbacks++;
+    }
+
+    region->base = mem_calloc(tag, 1, size);
+    if (!region->base) {
+        return -1;
+    }
+    region->size = size;
+    region->mode = REGION_MODE_HEAP;
+    region_mode_counts[REGION_MODE_HEAP]++;
+    return 0;
+}
+
+void mem_region_free(mem_region_t* region) {
+    if (!region->base) {
+        return;
+    }
+
+    if (region->mode == REGION_MODE_HEAP) {
+        mem_free(region->base);
+    } else {
+        munmap(region->base, region->size);
+    }
+    region->base = NULL;
+    region->size = 0;
+}
+
+BufferPool* buffer_pool_create(const char* name, size_t block_size, size_t block_count,
+                               bool hugepages, mem_tag_t tag) {
+    BufferPool* pool = mem_calloc(tag, 1, sizeof(BufferPool));
+    if (!pool) {
+        return NULL;
+    }
+
+    pool->name = name;
+    pool->block_size = block_size;
+    pool->block_count = block_count;
+    pool->tag = tag;
+
+    // 非大页模式下按需从堆中分配，保持原有内存占用
+    if (!hugepages) {
+        return pool;
+    }
+
+    if (mem_region_alloc(&pool->region, block_size * block_count, true, tag) != 0) {
+        mem_free(pool);
+        return NULL;
+    }
+
+    pool->free_stack = mem_malloc(tag, sizeof(size_t) * block_count);
+    if (!pool->free_stack) {
+        mem_region_free(&pool->region);
+        mem_free(pool);
+        return NULL;
+    }
+
+    // 倒序压栈，使低地址的块先被使用
+    for (size_t i = 0; i < block_count; i++) {
+        pool->free_stack[i] = block_count - 1 - i;
+    }
+    pool->free_top = block_count;
+    pool->use_region = true;
+
+    LOG_INFO("Buffer pool %s: %zu x %zu bytes, mode: %s",
+             name, block_count, block_size, mem_region_mode_name(pool->region.mode));
+    return pool;
+}
+
+void buffer_pool_destroy(BufferPool* pool) {
+    if (!pool) {
+        return;
+    }
+
+    if (pool->use_region) {
+        mem_region_free(&pool->region);
+        mem_free(pool->free_stack);
+    }
+    mem_free(pool);
+}
+
+void* buffer_pool_get(BufferPool* pool) {
+    void* block;
+
+    if (pool->use_region) {
+        if (pool->free_top == 0) {
+            LOG_ERROR("Buffer pool %s exhausted", pool->name);
+            return NULL;
+        }
+        size_t index = pool->free_stack[--pool->free_top];
+        block = (char*)pool->region.base + index * pool->block_size;
+    } else {
+        block = mem_malloc(pool->tag, pool->block_size);
+        if (!block) {
+            return NULL;
+        }
+    }
+
+    pool->in_use++;
+    if (pool->in_use > pool->peak_in_use) {
+        pool->peak_in_use = pool->in_use;
+    }
+    return block;
+}
+
+void buffer_pool_put(BufferPool* pool, void* block) {
+    if (!block) {
+        return;
+    }
+
+    if (pool->use_region) {
+        size_t index = ((char*)block - (char*)pool->region.base) / pool->block_size;
+        pool->free_stack[pool->free_top++] = index;
+    } else {
+        mem_free(block);
+    }
+    pool->in_use--;
+}
+
+void buffer_pool_dump(const BufferPool* pool) {
+    if (!pool) {
+        return;
+    }
+
+    LOG_INFO("Pool [%s] mode: %s, blocks in use: %zu/%zu, peak: %zu, block size: %zu, mapped: %zu bytes",
+             pool->name,
+             pool->use_region ? mem_region_mode_name(pool->region.mode) : "heap",
+             pool->in_use,
+             pool->block_count,
+             pool->peak_in_use,
+             pool->block_size,
+             pool->use_region ? pool->region.size : pool->in_use * pool->block_size);
+}
+
+void mem_region_stats_dump(void) {
+    LOG_INFO("Regions heap: %zu, hugetlb: %zu, thp: %zu, hugetlb fallbacks: %zu, thp fallbacks: %zu",
+             region_mode_counts[REGION_MODE_HEAP],
+             region_mode_counts[REGION_MODE_HUGETLB],
+             region_mode_counts[REGION_MODE_THP],
+             hugetlb_fallbacks,
+             thp_fallbacks);
+}
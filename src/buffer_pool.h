@@ -0,0 +1,54 @@
+#ifndef BUFFER_POOL_H
+#define BUFFER_POOL_H
+
+#include "mem_stats.h"
+#include <stdlib.h>
+#include <stdbool.h>
+
+#define HUGE_PAGE_SIZE (2UL * 1024 * 1024)
+
+// 内存区域的分配方式
+typedef enum {
+    REGION_MODE_HEAP,       // 普通堆内存
+    REGION_MODE_HUGETLB,    // MAP_HUGETLB 显式大页
+    REGION_MODE_THP         // 普通 mmap + MADV_HUGEPAGE 透明大页
+} region_mode_t;
+
+// 一段连续的大块内存
+typedef struct {
+    void* base;
+    size_t size;            // 实际映射/分配的大小
+    region_mode_t mode;
+    mem_tag_t tag;
+} mem_region_t;
+
+// 固定大小缓冲块的池
+typedef struct BufferPool {
+    const char* name;
+    size_t block_size;
+    size_t block_count;
+    mem_tag_t tag;
+    mem_region_t region;    // 大页模式下的后备区域
+    bool use_region;
+    size_t* free_stack;     // 空闲块下标栈
+    size_t free_top;
+    size_t in_use;
+    size_t peak_in_use;
+} BufferPool;
+
+// 分配区域；hugepages 为 true 时优先 MAP_HUGETLB，失败后回退到 THP
+int mem_region_alloc(mem_region_t* region, size_t size, bool hugepages, mem_tag_t tag);
+void mem_region_free(mem_region_t* region);
+const char* mem_region_mode_name(region_mode_t mode);
+
+BufferPool* buffer_pool_create(const char* name, size_t block_size, size_t block_count,
+                               bool hugepages, mem_tag_t tag);
+void buffer_pool_destroy(BufferPool* pool);
+void* buffer_pool_get(BufferPool* pool);
+void buffer_pool_put(BufferPool* pool, void* block);
+void buffer_pool_dump(const BufferPool* pool);
+
+// 输出所有区域分配方式的统计
+void mem_region_stats_dump(void);
+
+#endif
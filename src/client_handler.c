@@ -1,24 +1,48 @@
 #include "client_handler.h"
 #include "http_response.h"
 #include "logger.h"
+#include "mem_stats.h"
 #include "parse.h"
+#include "config.h"
+#include <stdlib.h>
 #include <unistd.h>
 #include <string.h>
 #include <errno.h>
 #include <arpa/inet.h>
+#include <sys/socket.h>
 
 #define PATH_MAX 1024
-#define DEFAULT_PATH "static_site"
 
-void client_init(client_t *client, int sockfd, struct sockaddr_in addr, size_t buffer_size)
+int client_init(client_t *client, int sockfd, struct sockaddr_in addr,
+                BufferPool *rx_pool, BufferPool *tx_pool, VhostTable *vhosts)
 {
+    client->buffer = buffer_pool_get(rx_pool);
+    if (!client->buffer)
+    {
+        return -1;
+    }
+
+    client->out = send_queue_create(tx_pool);
+    if (!client->out)
+    {
+        buffer_pool_put(rx_pool, client->buffer);
+        return -1;
+    }
+
     client->sockfd = sockfd;
     client->addr = addr;
-    client->buffer = malloc(buffer_size);
-    client->buf_size = buffer_size;
+    client->rx_pool = rx_pool;
+    client->vhosts = vhosts;
+    client->buf_size = rx_pool->block_size;
+    client->buf_start = 0;
     client->buf_len = 0;
+    client->buf_scan = 0;
     client->last_active = time(NULL);
-    client->queue = request_queue_create();
+    client->requests_served = 0;
+    client->closing = false;
+    client->write_shutdown = false;
+    client->reading_body = false;
+    return 0;
 }
 
 void client_destroy(client_t *client)
@@ -27,28 +51,66 @@ void client_destroy(client_t *client)
     {
         close(client->sockfd);
     }
-    free(client->buffer);
-    request_queue_destroy(client->queue);
+    buffer_pool_put(client->rx_pool, client->buffer);
+    send_queue_destroy(client->out);
 
     // 重置结构体
     memset(client, 0, sizeof(client_t));
 }
 
+static void client_process_requests(client_t *client);
+
+// 将未处理的数据移到缓冲区头部，只在写指针到达末尾时调用
+static void client_compact_buffer(client_t *client)
+{
+    size_t remaining = client->buf_len - client->buf_start;
+    memmove(client->buffer, client->buffer + client->buf_start, remaining);
+    client->buf_scan -= client->buf_start;
+    client->buf_start = 0;
+    client->buf_len = remaining;
+    client->buffer[client->buf_len] = '\0';
+}
+
 void client_handle(client_t *client)
 {
+    // 请求体正由发送队列经 splice 读取，不能再 recv 到接收缓冲区
+    if (client->reading_body)
+    {
+        return;
+    }
+
+    // 尾部没有连续空间时才压缩
+    if (client->buf_len >= client->buf_size - 1 && client->buf_start > 0)
+    {
+        client_compact_buffer(client);
+    }
+
     ssize_t bytes_read = recv(client->sockfd,
                               client->buffer + client->buf_len,
                               client->buf_size - client->buf_len - 1,
                               0);
 
+    if (bytes_read < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR))
+    {
+        return;
+    }
+
     if (bytes_read <= 0)
     {
         // 连接关闭或错误
         char client_ip[INET_ADDRSTRLEN];
         inet_ntop(AF_INET, &(client->addr.sin_addr), client_ip, INET_ADDRSTRLEN);
         LOG_INFO("Client %s:%d disconnected", client_ip, ntohs(client->addr.sin_port));
-        close(client->sockfd);
-        client->sockfd = 0;
+        client_destroy(client);
+        return;
+    }
+
+    // 连接即将关闭，丢弃客户端后续发送的数据，直到对方关闭或超时
+    if (client->closing)
+    {
+        client->buf_start = 0;
+        client->buf_len = 0;
+        client->buf_scan = 0;
         return;
     }
 
@@ -56,115 +118,367 @@ void client_handle(client_t *client)
     client->buffer[client->buf_len] = '\0';
     client->last_active = time(NULL);
 
-    // 处理pipeline请求
-    char *current_pos = client->buffer;
-    char *request_end;
+    client_process_requests(client);
+}
+
+// 将请求 URI 规范化为文档根目录 root 下的路径，去掉查询串并消除 . 和 .. 段
+// 同一文件的不同写法得到相同路径，作为文件缓存的键；越出根目录时返回 false
+static bool client_resolve_path(const char *root, const char *uri, char *out, size_t out_size)
+{
+    size_t root_len = strlen(root);
+    size_t len = root_len;
 
-    while ((request_end = strstr(current_pos, "\r\n\r\n")))
+    if (uri[0] != '/' || out_size <= root_len + 1)
     {
-        size_t request_size = request_end - current_pos + 4;
+        return false;
+    }
+    memcpy(out, root, root_len);
 
-        // 将完整的请求加入队列
-        if (!request_queue_push(client->queue, current_pos, request_size))
+    const char *p = uri;
+    while (*p && *p != '?' && *p != '#')
+    {
+        // 跳过连续的 '/'
+        while (*p == '/')
         {
-            LOG_ERROR("Failed to enqueue request");
-            http_send_status(client->sockfd, HTTP_STATUS_INTERNAL_ERROR);
-            return;
+            p++;
         }
 
-        current_pos = request_end + 4;
-
-        // 处理队列中的请求
-        while (request_queue_size(client->queue) > 0 &&
-               request_queue_size(client->queue) <= MAX_REQUESTS_IN_PIPELINE)
+        const char *seg = p;
+        while (*p && *p != '/' && *p != '?' && *p != '#')
         {
-            size_t request_len;
-            char *request_data = request_queue_pop(client->queue, &request_len);
-            if (!request_data)
-            {
-                break;
-            }
+            p++;
+        }
+        size_t seg_len = p - seg;
 
-            // 解析并处理请求
-            Request *request = parse(request_data, request_len);
-            if (request)
+        if (seg_len == 0 || (seg_len == 1 && seg[0] == '.'))
+        {
+            continue;
+        }
+        if (seg_len == 2 && seg[0] == '.' && seg[1] == '.')
+        {
+            if (len == root_len)
             {
-                if (strcmp(request->http_method, "GET") == 0)
-                {
-                    char full_path[PATH_MAX] = DEFAULT_PATH;
-                    if (strcmp(request->http_uri, "/") == 0)
-                    {
-                        strcat(full_path, "/index.html");
-                    }
-                    else
-                    {
-                        strcat(full_path, request->http_uri);
-                    }
-                    http_get_response(client->sockfd, full_path);
-                }
-                else if (strcmp(request->http_method, "HEAD") == 0)
-                {
-                    char full_path[PATH_MAX] = DEFAULT_PATH;
-                    if (strcmp(request->http_uri, "/") == 0)
-                    {
-                        strcat(full_path, "/index.html");
-                    }
-                    else
-                    {
-                        strcat(full_path, request->http_uri);
-                    }
-                    http_head_response(client->sockfd, full_path);
-                }
-                else if (strcmp(request->http_method, "POST") == 0)
-                {
-                    http_post_response(client->sockfd, request_data, request_len);
-                }
-                else
-                {
-                    http_send_status(client->sockfd, HTTP_STATUS_NOT_IMPLEMENTED);
-                }
-                free(request);
+                return false;
             }
-            else
+            while (out[--len] != '/')
             {
-                http_send_status(client->sockfd, HTTP_STATUS_BAD_REQUEST);
             }
+            continue;
+        }
 
-            free(request_data);
+        if (len + 1 + seg_len >= out_size)
+        {
+            return false;
         }
+        out[len++] = '/';
+        memcpy(out + len, seg, seg_len);
+        len += seg_len;
+    }
 
-        // 检查队列大小限制
-        if (request_queue_size(client->queue) > MAX_REQUESTS_IN_PIPELINE)
+    // 以 '/' 结尾的目录请求返回其 index.html
+    if (p == uri || p[-1] == '/' || len == root_len)
+    {
+        const char *index = "/index.html";
+        size_t index_len = strlen(index);
+        if (len + index_len >= out_size)
         {
-            LOG_ERROR("Too many requests in pipeline");
-            http_send_status(client->sockfd, HTTP_STATUS_INTERNAL_ERROR);
-            return;
+            return false;
         }
+        memcpy(out + len, index, index_len);
+        len += index_len;
+    }
+
+    out[len] = '\0';
+    return true;
+}
+
+// 按 HTTP 版本和 Connection 头决定响应后是否保持连接
+static bool client_keep_alive(const client_t *client, const Request *request)
+{
+    if (client->requests_served >= g_config.keepalive_requests)
+    {
+        return false;
+    }
+
+    const char *connection = request_get_header(request, "Connection");
+    if (strcmp(request->http_version, "HTTP/1.1") == 0)
+    {
+        return !connection || !header_has_token(connection, "close");
+    }
+    return connection && header_has_token(connection, "keep-alive");
+}
+
+// 由 Content-Length 得到请求体长度，没有该头时为 0；值无效时返回 -1
+static int client_body_length(const Request *request, size_t *len)
+{
+    const char *value = request_get_header(request, "Content-Length");
+    *len = 0;
+    if (!value)
+    {
+        return 0;
+    }
+
+    char *end;
+    errno = 0;
+    unsigned long long n = strtoull(value, &end, 10);
+    if (end == value || *end != '\0' || value[0] == '-' || errno == ERANGE)
+    {
+        return -1;
+    }
+    *len = (size_t)n;
+    return 0;
+}
+
+// 处理单个完整请求，响应写入发送队列；body 起的 body_avail 字节是缓冲区中紧随请求头的数据，
+// 返回其中属于本请求请求体的字节数。请求体超出缓冲区时由 POST 响应从 socket 转发剩余部分，
+// 其他方法无法跳过时关闭连接
+static size_t client_serve_request(client_t *client, char *request_data, size_t request_len,
+                                   const char *body, size_t body_avail)
+{
+    Request *request = parse(request_data, request_len);
+    http_ctx_t ctx = {client->out, client->vhosts->default_cache, request, false};
+
+    client->requests_served++;
+    if (!request)
+    {
+        http_send_status(&ctx, HTTP_STATUS_BAD_REQUEST);
+        client->closing = true;
+        return 0;
     }
+    ctx.keep_alive = client_keep_alive(client, request);
+    ctx.cache = vhost_lookup(client->vhosts, request_get_header(request, "Host"));
 
-    // 处理剩余数据
-    size_t remaining = client->buf_len - (current_pos - client->buffer);
-    if (remaining > 0 && current_pos != client->buffer)
+    // 不支持分块编码的请求体，无法确定下一个请求的起点
+    size_t body_len;
+    size_t consumed = 0;
+    if (request_get_header(request, "Transfer-Encoding"))
     {
-        memmove(client->buffer, current_pos, remaining);
-        client->buf_len = remaining;
+        http_send_status(&ctx, HTTP_STATUS_NOT_IMPLEMENTED);
+        ctx.keep_alive = false;
+    }
+    else if (client_body_length(request, &body_len) != 0)
+    {
+        LOG_ERROR("Invalid Content-Length");
+        http_send_status(&ctx, HTTP_STATUS_BAD_REQUEST);
+    }
+    else if (body_len > g_config.max_body_size)
+    {
+        LOG_ERROR("Request body too large: %zu bytes", body_len);
+        http_send_status(&ctx, HTTP_STATUS_CONTENT_TOO_LARGE);
+        ctx.keep_alive = false;
+    }
+    else if (strcmp(request->http_version, "HTTP/1.1") != 0 &&
+        strcmp(request->http_version, "HTTP/1.0") != 0)
+    {
+        http_send_status(&ctx, HTTP_STATUS_VERSION_NOT_SUPPORTED);
+    }
+    else if (strcmp(request->http_method, "GET") == 0 ||
+        strcmp(request->http_method, "HEAD") == 0)
+    {
+        char full_path[PATH_MAX];
+        if (!client_resolve_path(ctx.cache->root, request->http_uri, full_path, sizeof(full_path)))
+        {
+            LOG_ERROR("Invalid request URI: %s", request->http_uri);
+            http_send_status(&ctx, HTTP_STATUS_BAD_REQUEST);
+        }
+        else if (request->http_method[0] == 'G')
+        {
+            http_get_response(&ctx, full_path);
+        }
+        else
+        {
+            http_head_response(&ctx, full_path);
+        }
     }
-    else if (current_pos == client->buffer)
+    else if (strcmp(request->http_method, "POST") == 0)
     {
-        if (client->buf_len >= client->buf_size - 1)
+        consumed = body_len < body_avail ? body_len : body_avail;
+        if (!http_post_response(&ctx, client->sockfd, body, consumed, body_len))
+        {
+            ctx.keep_alive = false;
+        }
+        else if (consumed < body_len)
         {
-            LOG_ERROR("Request too large");
-            http_send_status(client->sockfd, HTTP_STATUS_BAD_REQUEST);
-            client->buf_len = 0;
+            client->reading_body = true;
         }
     }
     else
     {
+        http_send_status(&ctx, HTTP_STATUS_NOT_IMPLEMENTED);
+    }
+
+    // 其他方法的请求体不使用，完整在缓冲区中时跳过，否则关闭连接
+    if (consumed == 0 && body_len > 0 && strcmp(request->http_method, "POST") != 0)
+    {
+        if (body_len <= body_avail)
+        {
+            consumed = body_len;
+        }
+        else
+        {
+            ctx.keep_alive = false;
+        }
+    }
+
+    // 响应中声明了 Connection: close，之后的请求不再处理
+    if (!ctx.keep_alive)
+    {
+        client->closing = true;
+    }
+    free_request(request);
+    return consumed;
+}
+
+// 处理缓冲区中的完整请求，未发送完的响应达到上限时停止，返回是否因上限而停止
+static bool client_parse_batch(client_t *client)
+{
+    // 处理pipeline请求，从读指针开始，并跳过上次已扫描过的数据
+    char *current_pos = client->buffer + client->buf_start;
+    char *scan_pos = client->buffer + client->buf_scan;
+    char *request_end = NULL;
+    bool throttled = false;
+
+    while (!client->closing && !client->reading_body &&
+           !(throttled = client->out->pending_responses >= g_config.pipeline_depth) &&
+           (request_end = strstr(scan_pos, "\r\n\r\n")))
+    {
+        // 解析器不修改输入，直接处理接收缓冲区中的请求，跳过其后已读入的请求体
+        char *request_data = current_pos;
+        size_t request_len = request_end - current_pos + 4;
+        current_pos = request_end + 4;
+
+        size_t body_avail = client->buffer + client->buf_len - current_pos;
+        current_pos += client_serve_request(client, request_data, request_len, current_pos, body_avail);
+        scan_pos = current_pos;
+    }
+
+    // 移动读指针，剩余数据留在原地等待后续recv；连接即将关闭时丢弃剩余数据
+    client->buf_start = current_pos - client->buffer;
+    if (client->closing || client->buf_start == client->buf_len)
+    {
+        // 数据已全部消费，直接重置游标，无需拷贝
+        client->buf_start = 0;
+        client->buf_len = 0;
+        client->buf_scan = 0;
+        return false;
+    }
+
+    if (throttled)
+    {
+        // 剩余数据尚未扫描，恢复后从读指针开始查找
+        client->buf_scan = client->buf_start;
+        return true;
+    }
+
+    // 下次从末尾3字节前继续查找请求结束符
+    client->buf_scan = client->buf_len > client->buf_start + 3 ? client->buf_len - 3 : client->buf_start;
+
+    // 缓冲区已满且找不到完整请求
+    if (client->buf_start == 0 && client->buf_len >= client->buf_size - 1)
+    {
+        http_ctx_t ctx = {client->out, client->vhosts->default_cache, NULL, false};
+        LOG_ERROR("Request too large");
+        http_send_status(&ctx, HTTP_STATUS_BAD_REQUEST);
+        client->closing = true;
         client->buf_len = 0;
+        client->buf_scan = 0;
+    }
+    return false;
+}
+
+// 处理积压请求并发送响应；响应被 socket 全部接收后继续处理剩余请求
+static void client_process_requests(client_t *client)
+{
+    bool throttled;
+    do
+    {
+        throttled = client_parse_batch(client);
+
+        // 本批次所有响应一次性发送
+        if (client_flush(client) != 0)
+        {
+            return;
+        }
+    } while (throttled && client->out->pending_responses < g_config.pipeline_depth);
+}
+
+int client_flush(client_t *client)
+{
+    if (!send_queue_empty(client->out))
+    {
+        if (send_queue_flush(client->out, client->sockfd, g_config.send_slice) != 0)
+        {
+            client_destroy(client);
+            return -1;
+        }
+        client->last_active = time(NULL);
+    }
+
+    // 转发请求体后不再处理新请求，队列排空即请求体已读完，socket 中之后的数据属于下一个请求
+    if (client->reading_body && send_queue_empty(client->out))
+    {
+        client->reading_body = false;
+    }
+
+    // 最后一个响应发送完毕后关闭写方向，客户端读到 EOF 后关闭连接；
+    // 不直接 close，避免未读数据触发 RST 导致客户端丢失已发送的响应
+    if (client->closing && !client->write_shutdown && send_queue_empty(client->out))
+    {
+        shutdown(client->sockfd, SHUT_WR);
+        client->write_shutdown = true;
+    }
+    return 0;
+}
+
+void client_handle_write(client_t *client)
+{
+    if (client_flush(client) != 0)
+    {
+        return;
+    }
+
+    // 响应排空后继续处理缓冲区中积压的请求
+    if (!client->closing && client->buf_len > client->buf_start &&
+        client->out->pending_responses < g_config.pipeline_depth)
+    {
+        client_process_requests(client);
+    }
+}
+
+bool client_has_pending_output(const client_t *client)
+{
+    return !send_queue_empty(client->out) && send_queue_waiting_fd(client->out) < 0;
+}
+
+int client_waiting_fd(const client_t *client)
+{
+    return send_queue_waiting_fd(client->out);
+}
+
+bool client_wants_read(const client_t *client)
+{
+    // 请求体由发送队列读取，等待可读通过 client_waiting_fd 完成
+    if (client->reading_body)
+    {
+        return false;
+    }
+    // 关闭写方向后继续读取，以便发现客户端关闭
+    if (client->write_shutdown)
+    {
+        return true;
     }
+    // 未发送完的响应过多时停止读取，由 TCP 流控向客户端施加背压
+    return client->out->pending_responses < g_config.pipeline_depth;
 }
 
-bool client_is_timeout(const client_t *client, time_t timeout_secs)
+bool client_is_timeout(const client_t *client)
 {
-    return (time(NULL) - client->last_active) > timeout_secs;
+    // 响应体正在等待管道、设备等来源产生数据时不算空闲，如 tail -f 可以长时间没有输出；
+    // 等待的是客户端 socket 本身（读取请求体）时仍按空闲超时处理
+    int waiting_fd = client_waiting_fd(client);
+    if (waiting_fd >= 0 && waiting_fd != client->sockfd)
+    {
+        return false;
+    }
+    return (time(NULL) - client->last_active) >= g_config.keepalive_timeout;
 }
\ No newline at end of file
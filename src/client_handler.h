@@ -1,30 +1,49 @@
 #ifndef CLIENT_HANDLER_H
 #define CLIENT_HANDLER_H
 
-#include "request_queue.h"
+#include "buffer_pool.h"
+#include "send_queue.h"
+#include "vhost.h"
 #include <netinet/in.h>
 #include <time.h>
 #include <stdbool.h>
 
 #define BUF_SIZE 4096
-#define MAX_REQUESTS_IN_PIPELINE 10
-#define MAX_CONTENT_LENGTH 1048576 // 1MB 最大 POST 数据大小
+#define DEFAULT_PATH "static_site"
 
 // 客户端上下文结构体
 typedef struct {
     int sockfd;                    // 客户端socket
     struct sockaddr_in addr;       // 客户端地址
     char* buffer;                  // 接收缓冲区
+    BufferPool* rx_pool;           // 接收缓冲区所属的池
     size_t buf_size;              // 缓冲区大小
-    size_t buf_len;               // 当前缓冲区使用长度
+    size_t buf_start;             // 读指针，未处理数据的起始位置
+    size_t buf_len;               // 写指针，已接收数据的结束位置
+    size_t buf_scan;              // 请求结束符的续扫位置
     time_t last_active;           // 最后活动时间
-    RequestQueue* queue;          // 请求队列
+    SendQueue* out;               // 待发送的响应
+    VhostTable* vhosts;           // 按 Host 头选择站点的文件缓存
+    int requests_served;          // 该连接已处理的请求数
+    bool closing;                 // 已决定关闭连接，不再处理后续请求
+    bool write_shutdown;          // 响应发送完毕后已关闭写方向，等待客户端关闭
+    bool reading_body;            // 请求体的剩余部分由发送队列从 socket 直接转发，期间不 recv
 } client_t;
 
 // 函数声明
-void client_init(client_t* client, int sockfd, struct sockaddr_in addr, size_t buffer_size);
+int client_init(client_t* client, int sockfd, struct sockaddr_in addr,
+                BufferPool* rx_pool, BufferPool* tx_pool, VhostTable* vhosts);
 void client_destroy(client_t* client);
 void client_handle(client_t* client);
-bool client_is_timeout(const client_t* client, time_t timeout_secs);
+// 发送队列中的响应，连接出错时销毁客户端并返回 -1
+int client_flush(client_t* client);
+// socket 可写时继续发送，并恢复处理积压的请求
+void client_handle_write(client_t* client);
+// 有未发完的响应且需要等待 socket 可写
+bool client_has_pending_output(const client_t* client);
+// 响应体的来源暂时没有数据时返回来源 fd，可读后调用 client_handle_write；否则返回 -1
+int client_waiting_fd(const client_t* client);
+bool client_wants_read(const client_t* client);
+bool client_is_timeout(const client_t* client);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,84 @@
+#include "compress.h"
+#include "mem_stats.h"
+#include "logger.h"
+#include <string.h>
+#include <zlib.h>
+
+// 单个 MIME 类型的压缩统计
+struct compress_stat {
+    const char *content_type;
+    size_t files;
+    size_t in_bytes;
+    size_t out_bytes;
+};
+
+static struct compress_stat stats[COMPRESS_STATS_MAX];
+static size_t stat_count;
+
+// zlib 内部状态计入 compress 标签
+static voidpf zlib_alloc(voidpf opaque, uInt items, uInt size) {
+    (void)opaque;
+    return mem_calloc(MEM_TAG_COMPRESS, items, size);
+}
+
+static void zlib_free(voidpf opaque, voidpf ptr) {
+    (void)opaque;
+    mem_free(ptr);
+}
+
+ssize_t compress_gzip(const char *in, size_t in_len, int level, char *out, size_t out_size) {
+    z_stream stream;
+    memset(&stream, 0, sizeof(stream));
+    stream.zalloc = zlib_alloc;
+    stream.zfree = zlib_free;
+
+    // windowBits 加 16 输出 gzip 格式
+    if (deflateInit2(&stream, level, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        LOG_ERROR("deflateInit2 failed");
+        return -1;
+    }
+
+    stream.next_in = (Bytef *)in;
+    stream.avail_in = in_len;
+    stream.next_out = (Bytef *)out;
+    stream.avail_out = out_size;
+    int ret = deflate(&stream, Z_FINISH);
+    size_t out_len = stream.total_out;
+    deflateEnd(&stream);
+
+    // 输出缓冲区写满仍未结束说明压缩后不比原文件小
+    if (ret != Z_STREAM_END || out_len >= out_size) {
+        return -1;
+    }
+    return out_len;
+}
+
+void compress_stats_record(const char *content_type, size_t in_len, size_t out_len) {
+    size_t i;
+    for (i = 0; i < stat_count; i++) {
+        if (stats[i].content_type == content_type) {
+            break;
+        }
+    }
+    if (i == stat_count) {
+        if (stat_count == COMPRESS_STATS_MAX) {
+            return;
+        }
+        stats[stat_count++].content_type = content_type;
+    }
+
+    stats[i].files++;
+    stats[i].in_bytes += in_len;
+    stats[i].out_bytes += out_len;
+}
+
+void compress_stats_dump(void) {
+    for (size_t i = 0; i < stat_count; i++) {
+        LOG_INFO("Gzip [%s] files: %zu, in: %zu bytes, out: %zu bytes, ratio: %.3f",
+                 stats[i].content_type,
+                 stats[i].files,
+                 stats[i].in_bytes,
+                 stats[i].out_bytes,
+                 stats[i].in_bytes ? (double)stats[i].out_bytes / stats[i].in_bytes : 0.0);
+    }
+}
@@ -0,0 +1,16 @@
+#ifndef COMPRESS_H
+#define COMPRESS_H
+
+#include <stdlib.h>
+#include <sys/types.h>
+
+#define COMPRESS_STATS_MAX 16 // 分别统计压缩率的 MIME 类型数
+
+// gzip 压缩 in 到 out，返回压缩后的长度；结果不小于 out_size（无收益）或出错时返回 -1
+ssize_t compress_gzip(const char *in, size_t in_len, int level, char *out, size_t out_size);
+
+// 按 MIME 类型累计压缩前后的字节数，content_type 须为静态字符串
+void compress_stats_record(const char *content_type, size_t in_len, size_t out_len);
+void compress_stats_dump(void);
+
+#endif
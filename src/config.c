@@ -0,0 +1,318 @@
+#include "config.h"
+#include "mime.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include <limits.h>
+
+server_config_t g_config = {
+    .hugepages = false,
+    .pipeline_depth = DEFAULT_PIPELINE_DEPTH,
+    .cache_size = DEFAULT_CACHE_SIZE,
+    .open_file_cache = DEFAULT_OPEN_FILE_CACHE,
+    .open_file_ttl = DEFAULT_OPEN_FILE_TTL,
+    .keepalive_requests = DEFAULT_KEEPALIVE_REQUESTS,
+    .keepalive_timeout = DEFAULT_KEEPALIVE_TIMEOUT,
+    .gzip_level = DEFAULT_GZIP_LEVEL,
+    .gzip_min_length = DEFAULT_GZIP_MIN_LENGTH,
+    .gzip_max_length = DEFAULT_GZIP_MAX_LENGTH,
+    .gzip_cache_size = DEFAULT_GZIP_CACHE_SIZE,
+    .mime_types = MIME_TYPES_DEFAULT,
+    .send_slice = DEFAULT_SEND_SLICE,
+    .prefetch_window = DEFAULT_PREFETCH_WINDOW,
+    .max_age = DEFAULT_MAX_AGE,
+    .max_body_size = DEFAULT_MAX_BODY_SIZE,
+    .log_buffer = DEFAULT_LOG_BUFFER,
+    .log_overflow = LOG_OVERFLOW_DROP,
+};
+
+// 解析不小于 min 的整数参数
+static int parse_int(const char* arg, int min, int* out) {
+    char* end;
+    long value = strtol(arg, &end, 10);
+    if (*arg == '\0' || *end != '\0' || value < min || value > INT_MAX) {
+        return -1;
+    }
+    *out = (int)value;
+    return 0;
+}
+
+// 解析字节数，支持 K/M/G 后缀
+static int parse_size(const char* arg, size_t* out) {
+    char* end;
+    unsigned long long value = strtoull(arg, &end, 10);
+    if (*arg == '\0' || *arg == '-' || end == arg) {
+        return -1;
+    }
+
+    switch (*end) {
+        case 'G': case 'g': value <<= 10; /* fall through */
+        case 'M': case 'm': value <<= 10; /* fall through */
+        case 'K': case 'k': value <<= 10; end++; break;
+        case '\0': break;
+        default: return -1;
+    }
+    if (*end != '\0') {
+        return -1;
+    }
+    *out = (size_t)value;
+    return 0;
+}
+
+// 解析 NAME=ROOT[,CACHE_SIZE]，校验通过后才就地切分参数字符串，出错时可以原样报告
+static int parse_vhost(char* arg, vhost_config_t* out) {
+    char* root = strchr(arg, '=');
+    if (!root || root == arg || root[1] == '\0') {
+        return -1;
+    }
+    char* size = strrchr(root, ',');
+    out->cache_size = (size_t)-1;
+    if (size && (size == root + 1 || parse_size(size + 1, &out->cache_size) != 0)) {
+        return -1;
+    }
+
+    *root++ = '\0';
+    if (size) {
+        *size = '\0';
+    }
+    // 去掉末尾的 '/'，与默认站点一样按 root/path 拼接
+    size_t len = strlen(root);
+    while (len > 1 && root[len - 1] == '/') {
+        root[--len] = '\0';
+    }
+    out->name = arg;
+    out->root = root;
+    return 0;
+}
+
+void config_usage(const char* prog) {
+    fprintf(stderr,
+            "Usage: %s [options]\n"
+            "  --hugepages              back buffer pools and connection table with 2MB huge pages\n"
+            "  --pipeline-depth N       stop reading from a connection with N responses outstanding (default %d)\n"
+            "  --cache-size SIZE        memory budget of the static file cache, 0 disables it (default %dM)\n"
+            "  --open-file-cache N      cache up to N open file descriptors and stat results, 0 disables it (default %d)\n"
+            "  --open-file-ttl SECS     seconds before a cached descriptor is reopened (default %d)\n"
+            "  --keepalive-requests N   close a connection after serving N requests (default %d)\n"
+            "  --keepalive-timeout SECS close a connection idle for SECS seconds (default %d)\n"
+            "  --gzip-level N           compress text responses at level N, 0 disables it (default %d)\n"
+            "  --gzip-min-length N      do not compress files smaller than N bytes (default %d)\n"
+            "  --gzip-max-length SIZE   do not compress files larger than SIZE (default %dK)\n"
+            "  --gzip-cache-size SIZE   memory budget of the compressed variant cache (default %dM)\n"
+            "  --pack FILE              serve the docroot from a pack built by liso_pack\n"
+            "  --mime-types FILE        map file extensions to MIME types (default %s)\n"
+            "  --send-slice SIZE        send at most SIZE bytes per connection per writable event (default %dK)\n"
+            "  --prefetch-window SIZE   read the first SIZE bytes of cold files in the background before sending, 0 disables it (default %dK)\n"
+            "  --max-age SECS           Cache-Control max-age of files requested without a content hash (default %d)\n"
+            "  --vhost NAME=ROOT[,SIZE] serve requests for Host NAME from ROOT with a SIZE file cache (repeatable)\n"
+            "  --max-body-size SIZE     reject request bodies larger than SIZE with 413 (default %dK)\n"
+            "  --post-sink FILE         append POST bodies to FILE and reply 204 instead of echoing them\n"
+            "  --log-buffer N           queue up to N log records for a background writer, 0 logs synchronously (default %d)\n"
+            "  --log-overflow MODE      when the log buffer is full, drop or block new records (default drop)\n"
+            "  -h, --help               show this help\n",
+            prog, DEFAULT_PIPELINE_DEPTH, DEFAULT_CACHE_SIZE >> 20,
+            DEFAULT_OPEN_FILE_CACHE, DEFAULT_OPEN_FILE_TTL,
+            DEFAULT_KEEPALIVE_REQUESTS, DEFAULT_KEEPALIVE_TIMEOUT,
+            DEFAULT_GZIP_LEVEL, DEFAULT_GZIP_MIN_LENGTH, DEFAULT_GZIP_MAX_LENGTH >> 10,
+            DEFAULT_GZIP_CACHE_SIZE >> 20,
+            MIME_TYPES_DEFAULT, DEFAULT_SEND_SLICE >> 10, DEFAULT_PREFETCH_WINDOW >> 10,
+            DEFAULT_MAX_AGE, DEFAULT_MAX_BODY_SIZE >> 10, DEFAULT_LOG_BUFFER);
+}
+
+int config_parse(int argc, char* argv[]) {
+    enum {
+        OPT_HUGEPAGES = 256,
+        OPT_PIPELINE_DEPTH,
+        OPT_CACHE_SIZE,
+        OPT_OPEN_FILE_CACHE,
+        OPT_OPEN_FILE_TTL,
+        OPT_KEEPALIVE_REQUESTS,
+        OPT_KEEPALIVE_TIMEOUT,
+        OPT_GZIP_LEVEL,
+        OPT_GZIP_MIN_LENGTH,
+        OPT_GZIP_MAX_LENGTH,
+        OPT_GZIP_CACHE_SIZE,
+        OPT_PACK,
+        OPT_MIME_TYPES,
+        OPT_SEND_SLICE,
+        OPT_PREFETCH_WINDOW,
+        OPT_MAX_AGE,
+        OPT_VHOST,
+        OPT_MAX_BODY_SIZE,
+        OPT_POST_SINK,
+        OPT_LOG_BUFFER,
+        OPT_LOG_OVERFLOW,
+    };
+
+    static const struct option long_options[] = {
+        {"hugepages",           no_argument,       NULL, OPT_HUGEPAGES},
+        {"pipeline-depth",      required_argument, NULL, OPT_PIPELINE_DEPTH},
+        {"cache-size",          required_argument, NULL, OPT_CACHE_SIZE},
+        {"open-file-cache",     required_argument, NULL, OPT_OPEN_FILE_CACHE},
+        {"open-file-ttl",       required_argument, NULL, OPT_OPEN_FILE_TTL},
+        {"keepalive-requests",  required_argument, NULL, OPT_KEEPALIVE_REQUESTS},
+        {"keepalive-timeout",   required_argument, NULL, OPT_KEEPALIVE_TIMEOUT},
+        {"gzip-level",          required_argument, NULL, OPT_GZIP_LEVEL},
+        {"gzip-min-length",     required_argument, NULL, OPT_GZIP_MIN_LENGTH},
+        {"gzip-max-length",     required_argument, NULL, OPT_GZIP_MAX_LENGTH},
+        {"gzip-cache-size",     required_argument, NULL, OPT_GZIP_CACHE_SIZE},
+        {"pack",                required_argument, NULL, OPT_PACK},
+        {"mime-types",          required_argument, NULL, OPT_MIME_TYPES},
+        {"send-slice",          required_argument, NULL, OPT_SEND_SLICE},
+        {"prefetch-window",     required_argument, NULL, OPT_PREFETCH_WINDOW},
+        {"max-age",             required_argument, NULL, OPT_MAX_AGE},
+        {"vhost",               required_argument, NULL, OPT_VHOST},
+        {"max-body-size",       required_argument, NULL, OPT_MAX_BODY_SIZE},
+        {"post-sink",           required_argument, NULL, OPT_POST_SINK},
+        {"log-buffer",          required_argument, NULL, OPT_LOG_BUFFER},
+        {"log-overflow",        required_argument, NULL, OPT_LOG_OVERFLOW},
+        {"help",                no_argument,       NULL, 'h'},
+        {NULL, 0, NULL, 0}
+    };
+
+    int opt;
+    while ((opt = getopt_long(argc, argv, "h", long_options, NULL)) != -1) {
+        switch (opt) {
+            case OPT_HUGEPAGES:
+                g_config.hugepages = true;
+                break;
+            case OPT_PIPELINE_DEPTH:
+                if (parse_int(optarg, 1, &g_config.pipeline_depth) != 0) {
+                    fprintf(stderr, "Invalid pipeline depth: %s\n", optarg);
+                    return -1;
+                }
+                break;
+            case OPT_CACHE_SIZE:
+                if (parse_size(optarg, &g_config.cache_size) != 0) {
+                    fprintf(stderr, "Invalid cache size: %s\n", optarg);
+                    return -1;
+                }
+                break;
+            case OPT_OPEN_FILE_CACHE:
+                if (parse_int(optarg, 0, &g_config.open_file_cache) != 0) {
+                    fprintf(stderr, "Invalid open file cache size: %s\n", optarg);
+                    return -1;
+                }
+                break;
+            case OPT_OPEN_FILE_TTL:
+                if (parse_int(optarg, 1, &g_config.open_file_ttl) != 0) {
+                    fprintf(stderr, "Invalid open file ttl: %s\n", optarg);
+                    return -1;
+                }
+                break;
+            case OPT_KEEPALIVE_REQUESTS:
+                if (parse_int(optarg, 1, &g_config.keepalive_requests) != 0) {
+                    fprintf(stderr, "Invalid keepalive requests: %s\n", optarg);
+                    return -1;
+                }
+                break;
+            case OPT_KEEPALIVE_TIMEOUT:
+                if (parse_int(optarg, 1, &g_config.keepalive_timeout) != 0) {
+                    fprintf(stderr, "Invalid keepalive timeout: %s\n", optarg);
+                    return -1;
+                }
+                break;
+            case OPT_GZIP_LEVEL:
+                if (parse_int(optarg, 0, &g_config.gzip_level) != 0 || g_config.gzip_level > 9) {
+                    fprintf(stderr, "Invalid gzip level: %s\n", optarg);
+                    return -1;
+                }
+                break;
+            case OPT_GZIP_MIN_LENGTH:
+                if (parse_int(optarg, 0, &g_config.gzip_min_length) != 0) {
+                    fprintf(stderr, "Invalid gzip min length: %s\n", optarg);
+                    return -1;
+                }
+                break;
+            case OPT_GZIP_MAX_LENGTH:
+                if (parse_size(optarg, &g_config.gzip_max_length) != 0) {
+                    fprintf(stderr, "Invalid gzip max length: %s\n", optarg);
+                    return -1;
+                }
+                break;
+            case OPT_GZIP_CACHE_SIZE:
+                if (parse_size(optarg, &g_config.gzip_cache_size) != 0) {
+                    fprintf(stderr, "Invalid gzip cache size: %s\n", optarg);
+                    return -1;
+                }
+                break;
+            case OPT_PACK:
+                g_config.pack_path = optarg;
+                break;
+            case OPT_MIME_TYPES:
+                g_config.mime_types = optarg;
+                break;
+            case OPT_SEND_SLICE:
+                if (parse_size(optarg, &g_config.send_slice) != 0 || g_config.send_slice == 0) {
+                    fprintf(stderr, "Invalid send slice: %s\n", optarg);
+                    return -1;
+                }
+                break;
+            case OPT_PREFETCH_WINDOW:
+                if (parse_size(optarg, &g_config.prefetch_window) != 0) {
+                    fprintf(stderr, "Invalid prefetch window: %s\n", optarg);
+                    return -1;
+                }
+                break;
+            case OPT_MAX_AGE:
+                if (parse_int(optarg, 0, &g_config.max_age) != 0) {
+                    fprintf(stderr, "Invalid max age: %s\n", optarg);
+                    return -1;
+                }
+                break;
+            case OPT_VHOST:
+                if (g_config.vhost_count == MAX_VHOSTS) {
+                    fprintf(stderr, "Too many virtual hosts (max %d)\n", MAX_VHOSTS);
+                    return -1;
+                }
+                if (parse_vhost(optarg, &g_config.vhosts[g_config.vhost_count]) != 0) {
+                    fprintf(stderr, "Invalid virtual host: %s\n", optarg);
+                    return -1;
+                }
+                g_config.vhost_count++;
+                break;
+            case OPT_MAX_BODY_SIZE:
+                if (parse_size(optarg, &g_config.max_body_size) != 0) {
+                    fprintf(stderr, "Invalid max body size: %s\n", optarg);
+                    return -1;
+                }
+                break;
+            case OPT_POST_SINK:
+                g_config.post_sink = optarg;
+                break;
+            case OPT_LOG_BUFFER:
+                if (parse_int(optarg, 0, &g_config.log_buffer) != 0) {
+                    fprintf(stderr, "Invalid log buffer size: %s\n", optarg);
+                    return -1;
+                }
+                break;
+            case OPT_LOG_OVERFLOW:
+                if (strcmp(optarg, "block") == 0) {
+                    g_config.log_overflow = LOG_OVERFLOW_BLOCK;
+                } else if (strcmp(optarg, "drop") == 0) {
+                    g_config.log_overflow = LOG_OVERFLOW_DROP;
+                } else {
+                    fprintf(stderr, "Invalid log overflow policy: %s\n", optarg);
+                    return -1;
+                }
+                break;
+            case 'h':
+            default:
+                return -1;
+        }
+    }
+
+    if (optind < argc) {
+        fprintf(stderr, "Unexpected argument: %s\n", argv[optind]);
+        return -1;
+    }
+
+    // --cache-size 可能出现在 --vhost 之后，解析完再补上默认预算
+    for (int i = 0; i < g_config.vhost_count; i++) {
+        if (g_config.vhosts[i].cache_size == (size_t)-1) {
+            g_config.vhosts[i].cache_size = g_config.cache_size;
+        }
+    }
+    return 0;
+}
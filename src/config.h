@@ -0,0 +1,64 @@
+#ifndef CONFIG_H
+#define CONFIG_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "logger.h"
+
+#define DEFAULT_PIPELINE_DEPTH 10
+#define DEFAULT_CACHE_SIZE (16 * 1024 * 1024)
+#define DEFAULT_OPEN_FILE_CACHE 256
+#define DEFAULT_OPEN_FILE_TTL 5
+#define DEFAULT_KEEPALIVE_REQUESTS 100
+#define DEFAULT_KEEPALIVE_TIMEOUT 5
+#define DEFAULT_GZIP_LEVEL 6
+#define DEFAULT_GZIP_MIN_LENGTH 256
+#define DEFAULT_GZIP_MAX_LENGTH (256 * 1024)
+#define DEFAULT_GZIP_CACHE_SIZE (8 * 1024 * 1024)
+#define DEFAULT_SEND_SLICE (256 * 1024)
+#define DEFAULT_PREFETCH_WINDOW (256 * 1024)
+#define DEFAULT_MAX_AGE 60
+#define DEFAULT_MAX_BODY_SIZE (1024 * 1024)
+#define DEFAULT_LOG_BUFFER 2048
+#define MAX_VHOSTS 64
+
+// 虚拟主机配置：--vhost NAME=ROOT[,CACHE_SIZE]
+typedef struct {
+    const char* name;
+    const char* root;
+    size_t cache_size;      // 该站点文件缓存的内存预算，未指定时沿用 --cache-size
+} vhost_config_t;
+
+// 服务器运行时配置，由命令行参数填充
+typedef struct {
+    bool hugepages;         // 缓冲池与连接表使用 2MB 大页
+    int pipeline_depth;     // 每个连接未发送完的响应上限，超过后暂停读取
+    size_t cache_size;      // 静态文件缓存的内存预算，0 表示禁用
+    int open_file_cache;    // 打开文件缓存的条目上限，0 表示禁用
+    int open_file_ttl;      // 打开文件缓存条目的有效期（秒）
+    int keepalive_requests; // 每个连接最多处理的请求数，达到后关闭连接
+    int keepalive_timeout;  // 空闲连接的超时时间（秒）
+    int gzip_level;         // 动态 gzip 压缩级别，0 表示禁用
+    int gzip_min_length;    // 小于该字节数的文件不压缩
+    size_t gzip_max_length; // 大于该字节数的文件不压缩，压缩在事件循环中同步进行
+    size_t gzip_cache_size; // 压缩变体缓存的内存预算
+    const char* pack_path;  // 文档根目录的 pack 映像，NULL 表示不使用
+    const char* mime_types; // mime.types 格式的扩展名映射文件
+    size_t send_slice;      // 每次可写事件中单个连接最多发送的字节数
+    size_t prefetch_window; // 发送前要求常驻页缓存的文件开头字节数，0 表示不预读
+    int max_age;            // 不带内容哈希的路径的 Cache-Control max-age（秒）
+    vhost_config_t vhosts[MAX_VHOSTS]; // 按 Host 头选择的站点，其余请求使用默认站点
+    int vhost_count;
+    size_t max_body_size;   // 请求体上限，超出时返回 413
+    const char* post_sink;  // POST 请求体追加写入的文件，NULL 表示原样回显
+    int log_buffer;         // 异步日志缓冲区的记录数，0 表示同步写日志
+    log_overflow_t log_overflow; // 异步日志缓冲区满时等待还是丢弃
+} server_config_t;
+
+extern server_config_t g_config;
+
+// 解析命令行参数，成功返回 0，参数错误返回 -1
+int config_parse(int argc, char* argv[]);
+void config_usage(const char* prog);
+
+#endif
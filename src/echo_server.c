@@ -13,6 +13,13 @@
 
 #include "echo_server.h"
 #include "logger.h"
+#include "mem_stats.h"
+#include "config.h"
+#include "compress.h"
+#include "mime.h"
+#include "splice_stream.h"
+#include "http_header.h"
+#include "http_response.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <fcntl.h>
@@ -22,10 +29,39 @@
 #include <unistd.h>
 #include <errno.h>
 #include <time.h>
+#include <signal.h>
 
 #define ECHO_PORT 9999
 #define MAX_CLIENTS 1024 // 最大客户端连接数
-#define TIMEOUT_SECS 5   // select超时时间(秒)
+#define TIMEOUT_SECS 1   // select超时时间(秒)，决定空闲连接超时检查的粒度
+
+// 收到 SIGUSR1 时置位，由主循环输出运行时统计
+static volatile sig_atomic_t dump_stats_requested = 0;
+
+static void handle_dump_signal(int sig)
+{
+    (void)sig;
+    dump_stats_requested = 1;
+}
+
+static void server_dump_stats(server_t *server)
+{
+    mem_stats_dump();
+    mem_region_stats_dump();
+    buffer_pool_dump(server->rx_pool);
+    buffer_pool_dump(server->tx_pool);
+    file_cache_dump(server->file_cache);
+    file_cache_dump(server->gzip_cache);
+    pack_dump(server->pack);
+    open_file_cache_dump(server->open_files);
+    prefetch_dump(server->prefetch);
+    fingerprint_dump(server->fingerprints);
+    vhost_dump(server->vhosts);
+    compress_stats_dump();
+    send_queue_dump_stats();
+    splice_stream_stats_dump();
+    log_dump_stats();
+}
 
 static int close_socket(int sock)
 {
@@ -78,6 +114,122 @@ int server_init(server_t *server) {
     int flags = fcntl(server->server_sock, F_GETFL, 0);
     fcntl(server->server_sock, F_SETFL, flags | O_NONBLOCK);
 
+    // 分配连接表和接收缓冲池
+    if (mem_region_alloc(&server->clients_region, sizeof(client_t) * MAX_CLIENTS,
+                         g_config.hugepages, MEM_TAG_CONN_TABLE) != 0) {
+        LOG_ERROR("Failed to allocate connection table");
+        close_socket(server->server_sock);
+        return -1;
+    }
+    server->clients = server->clients_region.base;
+    memset(server->clients, 0, sizeof(client_t) * MAX_CLIENTS);
+    LOG_INFO("Connection table mode: %s", mem_region_mode_name(server->clients_region.mode));
+
+    server->rx_pool = buffer_pool_create("rx", BUF_SIZE, MAX_CLIENTS,
+                                         g_config.hugepages, MEM_TAG_CONN_BUFFER);
+    if (!server->rx_pool) {
+        LOG_ERROR("Failed to create receive buffer pool");
+        mem_region_free(&server->clients_region);
+        close_socket(server->server_sock);
+        return -1;
+    }
+
+    server->tx_pool = buffer_pool_create("tx", BUF_SIZE, MAX_CLIENTS,
+                                         g_config.hugepages, MEM_TAG_RESPONSE);
+    if (!server->tx_pool) {
+        LOG_ERROR("Failed to create send buffer pool");
+        buffer_pool_destroy(server->rx_pool);
+        mem_region_free(&server->clients_region);
+        close_socket(server->server_sock);
+        return -1;
+    }
+
+    server->open_files = open_file_cache_create(g_config.open_file_cache, g_config.open_file_ttl);
+    server->file_cache = server->open_files ?
+                         file_cache_create(DEFAULT_PATH, g_config.cache_size, server->open_files) : NULL;
+    if (!server->file_cache) {
+        LOG_ERROR("Failed to create file cache");
+        open_file_cache_destroy(server->open_files);
+        buffer_pool_destroy(server->tx_pool);
+        buffer_pool_destroy(server->rx_pool);
+        mem_region_free(&server->clients_region);
+        close_socket(server->server_sock);
+        return -1;
+    }
+
+    server->gzip_cache = file_cache_create_derived("gzip", g_config.gzip_cache_size);
+    if (!server->gzip_cache) {
+        LOG_ERROR("Failed to create gzip cache");
+        file_cache_destroy(server->file_cache);
+        open_file_cache_destroy(server->open_files);
+        buffer_pool_destroy(server->tx_pool);
+        buffer_pool_destroy(server->rx_pool);
+        mem_region_free(&server->clients_region);
+        close_socket(server->server_sock);
+        return -1;
+    }
+    server->file_cache->gzip = server->gzip_cache;
+
+    if (g_config.pack_path) {
+        server->pack = pack_open(g_config.pack_path, DEFAULT_PATH);
+        if (!server->pack) {
+            LOG_ERROR("Failed to load pack %s", g_config.pack_path);
+            file_cache_destroy(server->gzip_cache);
+            file_cache_destroy(server->file_cache);
+            open_file_cache_destroy(server->open_files);
+            buffer_pool_destroy(server->tx_pool);
+            buffer_pool_destroy(server->rx_pool);
+            mem_region_free(&server->clients_region);
+            close_socket(server->server_sock);
+            return -1;
+        }
+        server->file_cache->pack = server->pack;
+    }
+
+    // 按内容哈希建立指纹路径，失败时所有路径按短期缓存发送；
+    // 指纹随 inotify 事件失效，无法监视文件变化时不建立
+    server->fingerprints = NULL;
+    if (file_cache_watch(server->file_cache) != 0) {
+        LOG_WARN("Cannot watch %s, serving without immutable URLs", DEFAULT_PATH);
+    } else if (!(server->fingerprints = fingerprint_build(DEFAULT_PATH, server->pack))) {
+        LOG_WARN("Failed to build fingerprint index, serving without immutable URLs");
+    }
+    server->file_cache->fingerprints = server->fingerprints;
+
+    // 预读线程启动失败时不影响服务，冷文件仍在事件循环中同步读取
+    server->prefetch = NULL;
+    if (g_config.prefetch_window > 0) {
+        server->prefetch = prefetch_create(g_config.prefetch_window);
+        if (!server->prefetch) {
+            LOG_WARN("Failed to start prefetcher, cold files will be read synchronously");
+        }
+        server->file_cache->prefetch = server->prefetch;
+    }
+
+    // 各虚拟主机有独立的文档根目录和缓存预算，其余共享组件沿用默认站点的配置
+    server->vhosts = vhost_table_create(server->file_cache);
+    for (int i = 0; server->vhosts && i < g_config.vhost_count; i++) {
+        const vhost_config_t *vc = &g_config.vhosts[i];
+        if (vhost_add(server->vhosts, vc->name, vc->root, vc->cache_size, server->open_files) != 0) {
+            vhost_table_destroy(server->vhosts);
+            server->vhosts = NULL;
+        }
+    }
+    if (!server->vhosts) {
+        LOG_ERROR("Failed to set up virtual hosts");
+        prefetch_destroy(server->prefetch);
+        fingerprint_destroy(server->fingerprints);
+        pack_close(server->pack);
+        file_cache_destroy(server->gzip_cache);
+        file_cache_destroy(server->file_cache);
+        open_file_cache_destroy(server->open_files);
+        buffer_pool_destroy(server->tx_pool);
+        buffer_pool_destroy(server->rx_pool);
+        mem_region_free(&server->clients_region);
+        close_socket(server->server_sock);
+        return -1;
+    }
+
     server->is_running = 1;
     return 0;
 }
@@ -85,19 +237,64 @@ int server_init(server_t *server) {
 // 主循环逻辑移到单独的函数中
 int server_run(server_t *server) {
     while (server->is_running) {
-                fd_set read_fds;
+        fd_set read_fds;
+        fd_set write_fds;
         struct timeval tv;
         int max_fd = server->server_sock;
 
         FD_ZERO(&read_fds);
+        FD_ZERO(&write_fds);
         FD_SET(server->server_sock, &read_fds);
 
+        // 文件变化通知
+        int cache_fd = file_cache_fd(server->file_cache);
+        if (cache_fd >= 0)
+        {
+            FD_SET(cache_fd, &read_fds);
+            if (cache_fd > max_fd)
+            {
+                max_fd = cache_fd;
+            }
+        }
+
+        max_fd = vhost_watch_fds(server->vhosts, &read_fds, max_fd);
+
+        // 后台预读完成通知
+        int ready_fd = prefetch_fd(server->prefetch);
+        if (ready_fd >= 0)
+        {
+            FD_SET(ready_fd, &read_fds);
+            if (ready_fd > max_fd)
+            {
+                max_fd = ready_fd;
+            }
+        }
+
         // 添加所有活跃的客户端到fd_set
         for (int i = 0; i < MAX_CLIENTS; i++)
         {
             if (server->clients[i].sockfd > 0)
             {
-                FD_SET(server->clients[i].sockfd, &read_fds);
+                // 背压期间不再读取该连接
+                if (client_wants_read(&server->clients[i]))
+                {
+                    FD_SET(server->clients[i].sockfd, &read_fds);
+                }
+                // 有未发完的响应时等待可写
+                if (client_has_pending_output(&server->clients[i]))
+                {
+                    FD_SET(server->clients[i].sockfd, &write_fds);
+                }
+                // 响应体来自管道等来源且暂无数据时等待来源可读
+                int waiting_fd = client_waiting_fd(&server->clients[i]);
+                if (waiting_fd >= 0)
+                {
+                    FD_SET(waiting_fd, &read_fds);
+                    if (waiting_fd > max_fd)
+                    {
+                        max_fd = waiting_fd;
+                    }
+                }
                 if (server->clients[i].sockfd > max_fd)
                 {
                     max_fd = server->clients[i].sockfd;
@@ -109,7 +306,18 @@ int server_run(server_t *server) {
         tv.tv_sec = TIMEOUT_SECS;
         tv.tv_usec = 0;
 
-        int activity = select(max_fd + 1, &read_fds, NULL, NULL, &tv);
+        int activity = select(max_fd + 1, &read_fds, &write_fds, NULL, &tv);
+
+        if (dump_stats_requested)
+        {
+            dump_stats_requested = 0;
+            server_dump_stats(server);
+        }
+
+        if (activity < 0 && errno == EINTR)
+        {
+            continue;
+        }
 
         if (activity < 0)
         {
@@ -117,6 +325,36 @@ int server_run(server_t *server) {
             continue;
         }
 
+        // 本轮生成的响应共用同一个 Date 头，每秒只格式化一次
+        http_common_update(time(NULL));
+
+        // 先处理文件变化，保证本轮不会发送已过期的缓存内容
+        if (cache_fd >= 0 && FD_ISSET(cache_fd, &read_fds))
+        {
+            file_cache_process_events(server->file_cache);
+        }
+        vhost_process_events(server->vhosts, &read_fds);
+
+        // 标记已完成的预读并立即继续发送；处理后这些连接不再等待 ready_fd，
+        // 发送循环无法再识别它们，因此先记下等待预读的连接
+        if (ready_fd >= 0 && FD_ISSET(ready_fd, &read_fds))
+        {
+            int resumed[MAX_CLIENTS];
+            int resumed_count = 0;
+            for (int i = 0; i < MAX_CLIENTS; i++)
+            {
+                if (server->clients[i].sockfd > 0 && client_waiting_fd(&server->clients[i]) == ready_fd)
+                {
+                    resumed[resumed_count++] = i;
+                }
+            }
+            prefetch_process(server->prefetch);
+            for (int k = 0; k < resumed_count; k++)
+            {
+                client_handle_write(&server->clients[resumed[k]]);
+            }
+        }
+
         // 处理新连接
         if (FD_ISSET(server->server_sock, &read_fds))
         {
@@ -144,7 +382,14 @@ int server_run(server_t *server) {
             {
                 if (server->clients[i].sockfd == 0)
                 {
-                    client_init(&server->clients[i], client_sock, client_addr, BUF_SIZE);
+                    if (client_init(&server->clients[i], client_sock, client_addr,
+                                    server->rx_pool, server->tx_pool, server->vhosts) != 0)
+                    {
+                        LOG_ERROR("Failed to allocate buffer for client %s:%d",
+                                  client_ip, ntohs(client_addr.sin_port));
+                        close(client_sock);
+                        break;
+                    }
 
                     LOG_INFO("New client connected - IP: %s, Port: %d, Socket: %d, Slot: %d",
                              client_ip,
@@ -165,6 +410,21 @@ int server_run(server_t *server) {
             }
         }
 
+        // 继续发送未发完的响应
+        for (int i = 0; i < MAX_CLIENTS; i++)
+        {
+            if (server->clients[i].sockfd <= 0)
+            {
+                continue;
+            }
+            int waiting_fd = client_waiting_fd(&server->clients[i]);
+            if (FD_ISSET(server->clients[i].sockfd, &write_fds) ||
+                (waiting_fd >= 0 && FD_ISSET(waiting_fd, &read_fds)))
+            {
+                client_handle_write(&server->clients[i]);
+            }
+        }
+
         // 处理客户端数据
         for (int i = 0; i < MAX_CLIENTS; i++)
         {
@@ -175,14 +435,11 @@ int server_run(server_t *server) {
         }
 
         // 检查超时连接
-        time_t current_time = time(NULL);
         for (int i = 0; i < MAX_CLIENTS; i++)
         {
-            if (server->clients[i].sockfd > 0 &&
-                (current_time - server->clients[i].last_active) > TIMEOUT_SECS)
+            if (server->clients[i].sockfd > 0 && client_is_timeout(&server->clients[i]))
             {
-                close(server->clients[i].sockfd);
-                server->clients[i].sockfd = 0;
+                client_destroy(&server->clients[i]);
             }
         }
     }
@@ -195,12 +452,27 @@ void server_cleanup(server_t *server) {
             client_destroy(&server->clients[i]);
         }
     }
+    vhost_table_destroy(server->vhosts);
+    buffer_pool_destroy(server->rx_pool);
+    buffer_pool_destroy(server->tx_pool);
+    file_cache_destroy(server->file_cache);
+    file_cache_destroy(server->gzip_cache);
+    pack_close(server->pack);
+    prefetch_destroy(server->prefetch);
+    fingerprint_destroy(server->fingerprints);
+    open_file_cache_destroy(server->open_files);
+    mem_region_free(&server->clients_region);
     close_socket(server->server_sock);
 }
 
 int main(int argc, char *argv[]) {
     server_t server;
     
+    if (config_parse(argc, argv) != 0) {
+        config_usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
     fprintf(stdout, "----- Echo Server -----\n");
 
     // 初始化日志
@@ -209,10 +481,42 @@ int main(int argc, char *argv[]) {
         return EXIT_FAILURE;
     }
 
+    // 日志写出移到后台线程；失败时保持同步写日志
+    if (g_config.log_buffer > 0 &&
+        log_start_async(g_config.log_buffer, g_config.log_overflow) != 0) {
+        LOG_WARN("Failed to start async logger, logging synchronously");
+    }
+
     LOG_INFO("Echo Server starting...");
 
+    // kill -USR1 <pid> 可输出内存统计
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = handle_dump_signal;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGUSR1, &sa, NULL);
+
+    // 对端关闭时 sendfile 会触发 SIGPIPE，改为返回 EPIPE
+    sa.sa_handler = SIG_IGN;
+    sigaction(SIGPIPE, &sa, NULL);
+
+    // 加载 MIME 类型映射，构建完美哈希
+    if (mime_init(g_config.mime_types) != 0) {
+        log_close();
+        return EXIT_FAILURE;
+    }
+
+    // 配置了 --post-sink 时 POST 请求体追加到该文件，否则原样回显
+    if (g_config.post_sink && http_post_sink_open(g_config.post_sink) != 0) {
+        mime_cleanup();
+        log_close();
+        return EXIT_FAILURE;
+    }
+
     // 初始化服务器
     if (server_init(&server) != 0) {
+        http_post_sink_close();
+        mime_cleanup();
         log_close();
         return EXIT_FAILURE;
     }
@@ -222,6 +526,8 @@ int main(int argc, char *argv[]) {
 
     // 清理资源
     server_cleanup(&server);
+    http_post_sink_close();
+    mime_cleanup();
     log_close();
     
     return result == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
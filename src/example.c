@@ -28,7 +28,6 @@ int main(int argc, char **argv){
     printf("Request Header\n");
     printf("Header name %s Header Value %s\n",request->headers[index].header_name,request->headers[index].header_value);
   }
-  free(request->headers);
-  free(request);
+  free_request(request);
   return 0;
 }
@@ -0,0 +1,473 @@
+#include "file_cache.h"
+#include "mem_stats.h"
+#include "logger.h"
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <limits.h>
+#include <sys/stat.h>
+#include <sys/inotify.h>
+
+#define WATCH_MASK (IN_MODIFY | IN_ATTRIB | IN_CLOSE_WRITE | IN_CREATE | IN_DELETE | \
+                    IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF)
+
+static uint32_t hash_path(const char *path) {
+    // FNV-1a
+    uint32_t hash = 2166136261u;
+    for (const unsigned char *p = (const unsigned char *)path; *p; p++) {
+        hash ^= *p;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+static void lru_unlink(FileCache *cache, FileCacheEntry *entry) {
+    if (entry->lru_prev) {
+        entry->lru_prev->lru_next = entry->lru_next;
+    } else {
+        cache->lru_head = entry->lru_next;
+    }
+    if (entry->lru_next) {
+        entry->lru_next->lru_prev = entry->lru_prev;
+    } else {
+        cache->lru_tail = entry->lru_prev;
+    }
+    entry->lru_prev = entry->lru_next = NULL;
+}
+
+static void lru_push_front(FileCache *cache, FileCacheEntry *entry) {
+    entry->lru_prev = NULL;
+    entry->lru_next = cache->lru_head;
+    if (cache->lru_head) {
+        cache->lru_head->lru_prev = entry;
+    } else {
+        cache->lru_tail = entry;
+    }
+    cache->lru_head = entry;
+}
+
+static void entry_unref(FileCacheEntry *entry) {
+    if (--entry->refcount == 0) {
+        mem_free(entry);
+    }
+}
+
+// 从缓存中摘除条目，发送队列中的引用释放后才真正释放内存
+static void entry_detach(FileCache *cache, FileCacheEntry *entry) {
+    FileCacheEntry **link = &cache->buckets[entry->hash & (FILE_CACHE_BUCKETS - 1)];
+    while (*link != entry) {
+        link = &(*link)->hash_next;
+    }
+    *link = entry->hash_next;
+
+    lru_unlink(cache, entry);
+    cache->used -= entry->charge;
+    cache->entry_count--;
+    entry->cached = false;
+    entry_unref(entry);
+}
+
+static FileCacheEntry* find_entry(FileCache *cache, const char *path, uint32_t hash) {
+    for (FileCacheEntry *entry = cache->buckets[hash & (FILE_CACHE_BUCKETS - 1)];
+         entry; entry = entry->hash_next) {
+        if (entry->hash == hash && strcmp(entry->path, path) == 0) {
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+// 移除某个路径的条目
+static void drop_path(FileCache *cache, const char *path) {
+    FileCacheEntry *entry = find_entry(cache, path, hash_path(path));
+    if (entry) {
+        LOG_INFO("File cache [%s] invalidated: %s", cache->root, path);
+        entry_detach(cache, entry);
+        cache->invalidations++;
+    }
+}
+
+// 移除某个目录下的所有条目
+static void drop_prefix(FileCache *cache, const char *dir) {
+    size_t len = strlen(dir);
+    FileCacheEntry *entry = cache->lru_head;
+    while (entry) {
+        FileCacheEntry *next = entry->lru_next;
+        if (strncmp(entry->path, dir, len) == 0 && entry->path[len] == '/') {
+            entry_detach(cache, entry);
+            cache->invalidations++;
+        }
+        entry = next;
+    }
+}
+
+// 使某个路径失效，连同由它派生的打开文件、指纹和压缩变体
+static void invalidate_path(FileCache *cache, const char *path) {
+    open_file_cache_invalidate(cache->open_files, path);
+    fingerprint_invalidate(cache->fingerprints, path);
+    if (cache->gzip) {
+        drop_path(cache->gzip, path);
+    }
+    drop_path(cache, path);
+}
+
+// 使某个目录下的所有路径失效
+static void invalidate_prefix(FileCache *cache, const char *dir) {
+    open_file_cache_invalidate_prefix(cache->open_files, dir);
+    fingerprint_invalidate_prefix(cache->fingerprints, dir);
+    if (cache->gzip) {
+        drop_prefix(cache->gzip, dir);
+    }
+    drop_prefix(cache, dir);
+}
+
+static void invalidate_all(FileCache *cache) {
+    while (cache->lru_head) {
+        entry_detach(cache, cache->lru_head);
+        cache->invalidations++;
+    }
+}
+
+static void add_watch(FileCache *cache, const char *dir) {
+    int wd = inotify_add_watch(cache->inotify_fd, dir, WATCH_MASK);
+    if (wd < 0) {
+        LOG_WARN("inotify_add_watch failed for %s: %s", dir, strerror(errno));
+        return;
+    }
+
+    for (size_t i = 0; i < cache->watch_count; i++) {
+        if (cache->watches[i].wd == wd) {
+            return;
+        }
+    }
+
+    if (cache->watch_count == cache->watch_capacity) {
+        size_t capacity = cache->watch_capacity ? cache->watch_capacity * 2 : 16;
+        struct cache_watch *watches = mem_realloc(MEM_TAG_FILE_CACHE, cache->watches,
+                                                  capacity * sizeof(struct cache_watch));
+        if (!watches) {
+            return;
+        }
+        cache->watches = watches;
+        cache->watch_capacity = capacity;
+    }
+
+    size_t len = strlen(dir);
+    char *copy = mem_malloc(MEM_TAG_FILE_CACHE, len + 1);
+    if (!copy) {
+        return;
+    }
+    memcpy(copy, dir, len + 1);
+    cache->watches[cache->watch_count].wd = wd;
+    cache->watches[cache->watch_count].dir = copy;
+    cache->watch_count++;
+
+    // 递归监视子目录
+    DIR *d = opendir(dir);
+    if (!d) {
+        return;
+    }
+    struct dirent *ent;
+    while ((ent = readdir(d)) != NULL) {
+        if (strcmp(ent->d_name, ".") == 0 || strcmp(ent->d_name, "..") == 0) {
+            continue;
+        }
+        char child[PATH_MAX];
+        struct stat st;
+        snprintf(child, sizeof(child), "%s/%s", dir, ent->d_name);
+        if (stat(child, &st) == 0 && S_ISDIR(st.st_mode)) {
+            add_watch(cache, child);
+        }
+    }
+    closedir(d);
+}
+
+static void remove_watch(FileCache *cache, int wd) {
+    for (size_t i = 0; i < cache->watch_count; i++) {
+        if (cache->watches[i].wd == wd) {
+            mem_free(cache->watches[i].dir);
+            cache->watches[i] = cache->watches[--cache->watch_count];
+            return;
+        }
+    }
+}
+
+static const char* watch_dir(const FileCache *cache, int wd) {
+    for (size_t i = 0; i < cache->watch_count; i++) {
+        if (cache->watches[i].wd == wd) {
+            return cache->watches[i].dir;
+        }
+    }
+    return NULL;
+}
+
+FileCache* file_cache_create_derived(const char *name, size_t budget) {
+    FileCache *cache = mem_calloc(MEM_TAG_FILE_CACHE, 1, sizeof(FileCache));
+    if (!cache) {
+        return NULL;
+    }
+
+    size_t len = strlen(name);
+    cache->root = mem_malloc(MEM_TAG_FILE_CACHE, len + 1);
+    if (!cache->root) {
+        mem_free(cache);
+        return NULL;
+    }
+    memcpy(cache->root, name, len + 1);
+    cache->budget = budget;
+    cache->inotify_fd = -1;
+    return cache;
+}
+
+FileCache* file_cache_create(const char *root, size_t budget, OpenFileCache *open_files) {
+    FileCache *cache = file_cache_create_derived(root, budget);
+    if (!cache) {
+        return NULL;
+    }
+    cache->open_files = open_files;
+
+    if (budget == 0) {
+        return cache;
+    }
+
+    if (file_cache_watch(cache) != 0) {
+        // 无法感知文件变化时不能安全地缓存
+        LOG_WARN("File cache for %s disabled", root);
+        cache->budget = 0;
+        return cache;
+    }
+
+    LOG_INFO("File cache for %s: budget %zu bytes, watching %zu directories",
+             root, budget, cache->watch_count);
+    return cache;
+}
+
+int file_cache_watch(FileCache *cache) {
+    if (cache->inotify_fd >= 0) {
+        return 0;
+    }
+
+    cache->inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (cache->inotify_fd < 0) {
+        LOG_WARN("inotify unavailable for %s: %s", cache->root, strerror(errno));
+        return -1;
+    }
+    add_watch(cache, cache->root);
+    return 0;
+}
+
+void file_cache_destroy(FileCache *cache) {
+    if (!cache) {
+        return;
+    }
+
+    invalidate_all(cache);
+    for (size_t i = 0; i < cache->watch_count; i++) {
+        mem_free(cache->watches[i].dir);
+    }
+    mem_free(cache->watches);
+    if (cache->inotify_fd >= 0) {
+        close(cache->inotify_fd);
+    }
+    mem_free(cache->root);
+    mem_free(cache);
+}
+
+FileCacheEntry* file_cache_lookup(FileCache *cache, const char *path) {
+    if (cache->budget == 0) {
+        return NULL;
+    }
+
+    FileCacheEntry *entry = find_entry(cache, path, hash_path(path));
+    if (!entry) {
+        cache->misses++;
+        return NULL;
+    }
+
+    cache->hits++;
+    if (cache->lru_head != entry) {
+        lru_unlink(cache, entry);
+        lru_push_front(cache, entry);
+    }
+    entry->refcount++;
+    return entry;
+}
+
+bool file_cache_admits(const FileCache *cache, size_t size) {
+    return cache->budget > 0 && size <= FILE_CACHE_MAX_ENTRY && size <= cache->budget / 4;
+}
+
+// 分配条目并填入键和响应头，内容由调用者写入 entry->data + header_len
+static FileCacheEntry* entry_create(const char *path, const char *header, size_t header_len,
+                                    size_t body_len, ino_t ino, time_t mtime) {
+    size_t path_len = strlen(path);
+    size_t charge = sizeof(FileCacheEntry) + path_len + 1 + header_len + body_len;
+
+    FileCacheEntry *entry = mem_malloc(MEM_TAG_FILE_CACHE, charge);
+    if (!entry) {
+        return NULL;
+    }
+
+    memset(entry, 0, sizeof(FileCacheEntry));
+    entry->path = (char *)(entry + 1);
+    memcpy(entry->path, path, path_len + 1);
+    entry->data = entry->path + path_len + 1;
+    memcpy(entry->data, header, header_len);
+    entry->header_len = header_len;
+    entry->body_len = body_len;
+    entry->ino = ino;
+    entry->mtime = mtime;
+    entry->charge = charge;
+    entry->hash = hash_path(path);
+    return entry;
+}
+
+// 替换旧条目，并按 LRU 淘汰直到满足预算
+static FileCacheEntry* entry_insert(FileCache *cache, FileCacheEntry *entry) {
+    FileCacheEntry *old = find_entry(cache, entry->path, entry->hash);
+    if (old) {
+        entry_detach(cache, old);
+    }
+    while (cache->lru_tail && cache->used + entry->charge > cache->budget) {
+        entry_detach(cache, cache->lru_tail);
+        cache->evictions++;
+    }
+
+    FileCacheEntry **bucket = &cache->buckets[entry->hash & (FILE_CACHE_BUCKETS - 1)];
+    entry->hash_next = *bucket;
+    *bucket = entry;
+    lru_push_front(cache, entry);
+    cache->used += entry->charge;
+    cache->entry_count++;
+    entry->cached = true;
+
+    // 一个引用属于缓存，一个属于调用者
+    entry->refcount = 2;
+    return entry;
+}
+
+FileCacheEntry* file_cache_insert(FileCache *cache, const char *path,
+                                  const char *header, size_t header_len,
+                                  const OpenFileEntry *file) {
+    size_t body_len = file->size;
+    FileCacheEntry *entry = entry_create(path, header, header_len, body_len, file->ino, file->mtime);
+    if (!entry) {
+        return NULL;
+    }
+
+    // 读取文件内容
+    size_t done = 0;
+    while (done < body_len) {
+        ssize_t n = pread(file->fd, entry->data + header_len + done, body_len - done, done);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            LOG_ERROR("Failed to read %s into cache: %s", path, n < 0 ? strerror(errno) : "short read");
+            mem_free(entry);
+            return NULL;
+        }
+        done += n;
+    }
+
+    return entry_insert(cache, entry);
+}
+
+FileCacheEntry* file_cache_insert_data(FileCache *cache, const char *path,
+                                       const char *header, size_t header_len,
+                                       const char *body, size_t body_len,
+                                       ino_t ino, time_t mtime) {
+    FileCacheEntry *entry = entry_create(path, header, header_len, body_len, ino, mtime);
+    if (!entry) {
+        return NULL;
+    }
+    memcpy(entry->data + header_len, body, body_len);
+    return entry_insert(cache, entry);
+}
+
+void file_cache_retain(FileCacheEntry *entry) {
+    entry->refcount++;
+}
+
+void file_cache_release(void *entry) {
+    entry_unref((FileCacheEntry *)entry);
+}
+
+int file_cache_fd(const FileCache *cache) {
+    return cache->inotify_fd;
+}
+
+void file_cache_process_events(FileCache *cache) {
+    char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+
+    for (;;) {
+        ssize_t len = read(cache->inotify_fd, buf, sizeof(buf));
+        if (len <= 0) {
+            if (len < 0 && errno != EAGAIN && errno != EINTR) {
+                LOG_ERROR("Failed to read inotify events: %s", strerror(errno));
+            }
+            return;
+        }
+
+        for (char *p = buf; p < buf + len; ) {
+            const struct inotify_event *ev = (const struct inotify_event *)p;
+            p += sizeof(struct inotify_event) + ev->len;
+
+            if (ev->mask & IN_Q_OVERFLOW) {
+                LOG_WARN("inotify queue overflow, flushing file cache");
+                invalidate_all(cache);
+                open_file_cache_invalidate_all(cache->open_files);
+                fingerprint_invalidate_all(cache->fingerprints);
+                if (cache->gzip) {
+                    invalidate_all(cache->gzip);
+                }
+                continue;
+            }
+            if (ev->mask & IN_IGNORED) {
+                remove_watch(cache, ev->wd);
+                continue;
+            }
+
+            const char *dir = watch_dir(cache, ev->wd);
+            if (!dir) {
+                continue;
+            }
+            if (ev->mask & (IN_DELETE_SELF | IN_MOVE_SELF)) {
+                invalidate_prefix(cache, dir);
+                continue;
+            }
+            if (ev->len == 0) {
+                continue;
+            }
+
+            char path[PATH_MAX];
+            snprintf(path, sizeof(path), "%s/%s", dir, ev->name);
+
+            if (ev->mask & IN_ISDIR) {
+                invalidate_prefix(cache, path);
+                if (ev->mask & (IN_CREATE | IN_MOVED_TO)) {
+                    add_watch(cache, path);
+                }
+            } else {
+                invalidate_path(cache, path);
+            }
+        }
+    }
+}
+
+void file_cache_dump(const FileCache *cache) {
+    if (!cache) {
+        return;
+    }
+
+    LOG_INFO("File cache [%s] entries: %zu, used: %zu/%zu bytes, hits: %zu, misses: %zu, evictions: %zu, invalidations: %zu",
+             cache->root,
+             cache->entry_count,
+             cache->used,
+             cache->budget,
+             cache->hits,
+             cache->misses,
+             cache->evictions,
+             cache->invalidations);
+}
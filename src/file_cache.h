@@ -0,0 +1,100 @@
+#ifndef FILE_CACHE_H
+#define FILE_CACHE_H
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "open_file_cache.h"
+#include "pack.h"
+#include "prefetch.h"
+#include "fingerprint.h"
+
+#define FILE_CACHE_BUCKETS 1024
+#define FILE_CACHE_MAX_ENTRY (1024 * 1024) // 超过该大小的文件不缓存
+
+// 缓存条目：预渲染的响应头与文件内容连续存放
+typedef struct FileCacheEntry {
+    char *path;                 // 键：解析后的文件路径
+    char *data;                 // 响应头 + 文件内容
+    size_t header_len;
+    size_t body_len;
+    ino_t ino;                  // 缓存时文件的 inode 和修改时间，用于条件请求
+    time_t mtime;
+    const char *content_type;   // 解析出的 MIME 类型，由插入者设置，使每个文件只解析一次
+    size_t charge;              // 计入内存预算的字节数
+    int refcount;               // 缓存本身及发送队列中的引用
+    bool cached;                // 是否仍在缓存中（失效或淘汰后为 false）
+    uint32_t hash;
+    struct FileCacheEntry *hash_next;
+    struct FileCacheEntry *lru_prev;
+    struct FileCacheEntry *lru_next;
+} FileCacheEntry;
+
+// inotify 监视的目录
+struct cache_watch {
+    int wd;
+    char *dir;
+};
+
+// 带内存预算的 LRU 文件缓存，通过 inotify 在文件变化时失效
+typedef struct FileCache {
+    char *root;
+    OpenFileCache *open_files;  // 未命中时使用的打开文件缓存，随 inotify 事件一起失效
+    struct FileCache *gzip;     // 动态压缩变体的缓存，随本缓存的 inotify 事件失效，可为 NULL
+    PackImage *pack;            // 预先打包的站点映像，优先于文件系统，可为 NULL
+    Prefetcher *prefetch;       // 冷文件的后台预读，可为 NULL
+    FingerprintIndex *fingerprints; // 带内容哈希的路径索引，随 inotify 事件一起失效，可为 NULL
+    size_t budget;
+    size_t used;
+    FileCacheEntry *buckets[FILE_CACHE_BUCKETS];
+    FileCacheEntry *lru_head;   // 最近使用
+    FileCacheEntry *lru_tail;   // 最久未使用
+    size_t entry_count;
+
+    int inotify_fd;
+    struct cache_watch *watches;
+    size_t watch_count;
+    size_t watch_capacity;
+
+    // 统计
+    size_t hits;
+    size_t misses;
+    size_t evictions;
+    size_t invalidations;
+} FileCache;
+
+// budget 为 0 时禁用缓存
+FileCache* file_cache_create(const char *root, size_t budget, OpenFileCache *open_files);
+// 开始监视文件变化，缓存预算为 0 时也可调用，供指纹索引等依赖失效通知的组件使用；
+// 已在监视时直接返回 0，inotify 不可用时返回 -1
+int file_cache_watch(FileCache *cache);
+// 不监视文件变化的缓存，用于压缩变体等派生内容；作为 gzip 字段挂在站点缓存上时
+// 随站点的 inotify 事件失效，使用者另按条目的 inode 和 mtime 校验
+FileCache* file_cache_create_derived(const char *name, size_t budget);
+void file_cache_destroy(FileCache *cache);
+
+// 命中时返回增加了引用计数的条目，使用完毕后调用 file_cache_release
+FileCacheEntry* file_cache_lookup(FileCache *cache, const char *path);
+// 文件大小是否适合放入缓存
+bool file_cache_admits(const FileCache *cache, size_t size);
+// 从打开的文件读取内容并插入缓存，返回增加了引用计数的条目
+FileCacheEntry* file_cache_insert(FileCache *cache, const char *path,
+                                  const char *header, size_t header_len,
+                                  const OpenFileEntry *file);
+// 插入已在内存中的内容，返回增加了引用计数的条目
+FileCacheEntry* file_cache_insert_data(FileCache *cache, const char *path,
+                                       const char *header, size_t header_len,
+                                       const char *body, size_t body_len,
+                                       ino_t ino, time_t mtime);
+// 增加引用
+void file_cache_retain(FileCacheEntry *entry);
+// 释放引用，签名与发送队列的 release 回调一致
+void file_cache_release(void *entry);
+
+// inotify 描述符，缓存禁用或 inotify 不可用时返回 -1
+int file_cache_fd(const FileCache *cache);
+// 处理 inotify 事件，使变化的文件失效
+void file_cache_process_events(FileCache *cache);
+void file_cache_dump(const FileCache *cache);
+
+#endif
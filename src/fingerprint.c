@@ -0,0 +1,249 @@
+#include "fingerprint.h"
+#include "mem_stats.h"
+#include "logger.h"
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+#define READ_CHUNK (64 * 1024)
+
+static uint32_t hash_path(const char *path) {
+    // FNV-1a
+    uint32_t hash = 2166136261u;
+    for (const unsigned char *p = (const unsigned char *)path; *p; p++) {
+        hash ^= *p;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+// 内容哈希使用 64 位 FNV-1a，只用于区分同一文件的不同版本，不需要抗碰撞
+static uint64_t hash_content(uint64_t hash, const unsigned char *data, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        hash ^= data[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+#define CONTENT_HASH_INIT 14695981039346656037ull
+
+// 在文件名的扩展名前插入内容哈希：style.css -> style.<hash>.css，没有扩展名时追加在末尾
+static int add_entry(FingerprintIndex *index, const char *target, uint64_t content_hash) {
+    const char *base = strrchr(target, '/');
+    base = base ? base + 1 : target;
+    const char *ext = strrchr(base, '.');
+    if (!ext || ext == base) {
+        ext = base + strlen(base);
+    }
+
+    size_t target_len = strlen(target);
+    size_t prefix_len = ext - target;
+    size_t path_len = target_len + 1 + FINGERPRINT_HEX_LEN;
+    FingerprintEntry *entry = mem_malloc(MEM_TAG_FINGERPRINT,
+                                         sizeof(FingerprintEntry) + path_len + 1 + target_len + 1);
+    if (!entry) {
+        return -1;
+    }
+
+    static const char hex[] = "0123456789abcdef";
+    entry->path = (char *)(entry + 1);
+    memcpy(entry->path, target, prefix_len);
+    char *p = entry->path + prefix_len;
+    *p++ = '.';
+    for (int i = 0; i < FINGERPRINT_HEX_LEN; i++) {
+        *p++ = hex[(content_hash >> (60 - 4 * i)) & 0xf];
+    }
+    memcpy(p, ext, target_len - prefix_len + 1);
+
+    entry->target = entry->path + path_len + 1;
+    memcpy(entry->target, target, target_len + 1);
+    entry->hash = hash_path(entry->path);
+
+    FingerprintEntry **bucket = &index->buckets[entry->hash & (FINGERPRINT_BUCKETS - 1)];
+    entry->next = *bucket;
+    *bucket = entry;
+    index->count++;
+    LOG_INFO("Fingerprint %s -> %s", entry->path, entry->target);
+    return 0;
+}
+
+static int add_file(FingerprintIndex *index, const char *path, unsigned char *buf) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        LOG_WARN("Cannot open %s for fingerprinting: %s", path, strerror(errno));
+        return 0;
+    }
+
+    uint64_t hash = CONTENT_HASH_INIT;
+    ssize_t n;
+    while ((n = read(fd, buf, READ_CHUNK)) != 0) {
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            LOG_WARN("Cannot read %s for fingerprinting: %s", path, strerror(errno));
+            close(fd);
+            return 0;
+        }
+        hash = hash_content(hash, buf, n);
+    }
+    close(fd);
+    return add_entry(index, path, hash);
+}
+
+// 递归处理目录下的普通文件
+static int add_dir(FingerprintIndex *index, const char *dir, unsigned char *buf) {
+    DIR *d = opendir(dir);
+    if (!d) {
+        LOG_WARN("Cannot open %s for fingerprinting: %s", dir, strerror(errno));
+        return 0;
+    }
+
+    int ret = 0;
+    struct dirent *ent;
+    while (ret == 0 && (ent = readdir(d)) != NULL) {
+        if (strcmp(ent->d_name, ".") == 0 || strcmp(ent->d_name, "..") == 0) {
+            continue;
+        }
+        char child[PATH_MAX];
+        struct stat st;
+        if (snprintf(child, sizeof(child), "%s/%s", dir, ent->d_name) >= (int)sizeof(child) ||
+            stat(child, &st) != 0) {
+            continue;
+        }
+        if (S_ISDIR(st.st_mode)) {
+            ret = add_dir(index, child, buf);
+        } else if (S_ISREG(st.st_mode)) {
+            ret = add_file(index, child, buf);
+        }
+    }
+    closedir(d);
+    return ret;
+}
+
+static int add_pack(FingerprintIndex *index, const PackImage *pack) {
+    for (uint32_t i = 0; i < pack->count; i++) {
+        const struct pack_entry *e = &pack->index[i];
+        char path[PATH_MAX];
+        if (snprintf(path, sizeof(path), "%s/%.*s", pack->root, (int)e->path_len,
+                     pack_data(pack, e->path_offset)) >= (int)sizeof(path)) {
+            continue;
+        }
+        uint64_t hash = hash_content(CONTENT_HASH_INIT,
+                                     (const unsigned char *)pack_data(pack, e->body_offset), e->body_len);
+        if (add_entry(index, path, hash) != 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+FingerprintIndex* fingerprint_build(const char *root, const PackImage *pack) {
+    FingerprintIndex *index = mem_calloc(MEM_TAG_FINGERPRINT, 1, sizeof(FingerprintIndex));
+    if (!index) {
+        return NULL;
+    }
+
+    int ret;
+    if (pack) {
+        index->frozen = true;
+        ret = add_pack(index, pack);
+    } else {
+        unsigned char *buf = mem_malloc(MEM_TAG_FINGERPRINT, READ_CHUNK);
+        ret = buf ? add_dir(index, root, buf) : -1;
+        mem_free(buf);
+    }
+    if (ret != 0) {
+        LOG_ERROR("Failed to build fingerprint index for %s", root);
+        fingerprint_destroy(index);
+        return NULL;
+    }
+    return index;
+}
+
+static void remove_if(FingerprintIndex *index, bool (*match)(const FingerprintEntry *, const char *),
+                      const char *arg) {
+    for (size_t i = 0; i < FINGERPRINT_BUCKETS; i++) {
+        FingerprintEntry **link = &index->buckets[i];
+        while (*link) {
+            FingerprintEntry *entry = *link;
+            if (match && !match(entry, arg)) {
+                link = &entry->next;
+                continue;
+            }
+            *link = entry->next;
+            index->count--;
+            index->invalidations++;
+            mem_free(entry);
+        }
+    }
+}
+
+void fingerprint_destroy(FingerprintIndex *index) {
+    if (!index) {
+        return;
+    }
+    remove_if(index, NULL, NULL);
+    mem_free(index);
+}
+
+const char* fingerprint_resolve(FingerprintIndex *index, const char *path) {
+    if (!index) {
+        return NULL;
+    }
+
+    uint32_t hash = hash_path(path);
+    for (FingerprintEntry *entry = index->buckets[hash & (FINGERPRINT_BUCKETS - 1)];
+         entry; entry = entry->next) {
+        if (entry->hash == hash && strcmp(entry->path, path) == 0) {
+            index->hits++;
+            return entry->target;
+        }
+    }
+    return NULL;
+}
+
+static bool match_target(const FingerprintEntry *entry, const char *target) {
+    return strcmp(entry->target, target) == 0;
+}
+
+static bool match_prefix(const FingerprintEntry *entry, const char *dir) {
+    size_t len = strlen(dir);
+    return strncmp(entry->target, dir, len) == 0 && entry->target[len] == '/';
+}
+
+// 文件变化时遍历整个索引；变化远少于请求，不再为原文件路径单独建索引
+void fingerprint_invalidate(FingerprintIndex *index, const char *target) {
+    if (index && !index->frozen) {
+        remove_if(index, match_target, target);
+    }
+}
+
+void fingerprint_invalidate_prefix(FingerprintIndex *index, const char *dir) {
+    if (index && !index->frozen) {
+        remove_if(index, match_prefix, dir);
+    }
+}
+
+void fingerprint_invalidate_all(FingerprintIndex *index) {
+    if (index && !index->frozen) {
+        remove_if(index, NULL, NULL);
+    }
+}
+
+void fingerprint_dump(const FingerprintIndex *index) {
+    if (!index) {
+        return;
+    }
+
+    LOG_INFO("Fingerprints: %zu, hits: %zu, invalidations: %zu",
+             index->count,
+             index->hits,
+             index->invalidations);
+}
@@ -0,0 +1,45 @@
+#ifndef FINGERPRINT_H
+#define FINGERPRINT_H
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "pack.h"
+
+#define FINGERPRINT_BUCKETS 1024
+#define FINGERPRINT_HEX_LEN 8       // URL 中内容哈希的十六进制位数
+
+// 指纹路径到原文件的映射，例如 static_site/style.1a2b3c4d.css -> static_site/style.css
+typedef struct FingerprintEntry {
+    char *path;                 // 带内容哈希的路径（含文档根目录）
+    char *target;               // 原文件路径
+    uint32_t hash;
+    struct FingerprintEntry *next;
+} FingerprintEntry;
+
+// 启动时按文件内容哈希建立的索引；指纹路径对应的内容不会变化，可以永久缓存
+typedef struct FingerprintIndex {
+    FingerprintEntry *buckets[FINGERPRINT_BUCKETS];
+    size_t count;
+    bool frozen;                // 来自 pack 映像，不随文件系统变化失效
+
+    // 统计
+    size_t hits;
+    size_t invalidations;
+} FingerprintIndex;
+
+// 为 root 下的所有普通文件建立索引；pack 非空时改为使用 pack 映像中的内容
+FingerprintIndex* fingerprint_build(const char *root, const PackImage *pack);
+void fingerprint_destroy(FingerprintIndex *index);
+
+// 指纹路径返回原文件路径，其他路径返回 NULL
+const char* fingerprint_resolve(FingerprintIndex *index, const char *path);
+
+// 原文件变化后旧的指纹路径不再有效，直到重启后按新内容重新建立
+void fingerprint_invalidate(FingerprintIndex *index, const char *target);
+void fingerprint_invalidate_prefix(FingerprintIndex *index, const char *dir);
+void fingerprint_invalidate_all(FingerprintIndex *index);
+
+void fingerprint_dump(const FingerprintIndex *index);
+
+#endif
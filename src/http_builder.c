@@ -0,0 +1,133 @@
+#include "http_builder.h"
+
+#define STATUS_LINE(code, reason) {code, "HTTP/1.1 " #code " " reason "\r\n", sizeof("HTTP/1.1 " #code " " reason "\r\n") - 1}
+
+// 状态行及其长度，第一项为未知状态码时的默认值
+static const struct {
+    int code;
+    const char* line;
+    size_t len;
+} status_lines[] = {
+    STATUS_LINE(500, "Internal Server Error"),
+    STATUS_LINE(200, "OK"),
+    STATUS_LINE(204, "No Content"),
+    STATUS_LINE(206, "Partial Content"),
+    STATUS_LINE(304, "Not Modified"),
+    STATUS_LINE(400, "Bad Request"),
+    STATUS_LINE(404, "Not Found"),
+    STATUS_LINE(413, "Content Too Large"),
+    STATUS_LINE(416, "Range Not Satisfiable"),
+    STATUS_LINE(501, "Not Implemented"),
+    STATUS_LINE(505, "HTTP Version Not Supported"),
+};
+
+// 两位一组转换十进制，减少除法次数
+static const char digit_pairs[] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+static const char day_names[7][3] = {
+    {'S', 'u', 'n'}, {'M', 'o', 'n'}, {'T', 'u', 'e'}, {'W', 'e', 'd'},
+    {'T', 'h', 'u'}, {'F', 'r', 'i'}, {'S', 'a', 't'},
+};
+
+static const char month_names[12][3] = {
+    {'J', 'a', 'n'}, {'F', 'e', 'b'}, {'M', 'a', 'r'}, {'A', 'p', 'r'},
+    {'M', 'a', 'y'}, {'J', 'u', 'n'}, {'J', 'u', 'l'}, {'A', 'u', 'g'},
+    {'S', 'e', 'p'}, {'O', 'c', 't'}, {'N', 'o', 'v'}, {'D', 'e', 'c'},
+};
+
+void http_builder_terminate(http_builder_t* b) {
+    if (b->len == b->cap) {
+        b->overflow = true;
+        if (b->cap > 0) {
+            b->buf[b->cap - 1] = '\0';
+        }
+        return;
+    }
+    b->buf[b->len] = '\0';
+}
+
+void http_builder_status(http_builder_t* b, int status_code) {
+    size_t count = sizeof(status_lines) / sizeof(status_lines[0]);
+    size_t i;
+    for (i = count - 1; i > 0; i--) {
+        if (status_lines[i].code == status_code) {
+            break;
+        }
+    }
+    http_builder_append(b, status_lines[i].line, status_lines[i].len);
+}
+
+void http_builder_uint_pad(http_builder_t* b, unsigned long value, int width) {
+    char tmp[24];
+    char* p = tmp + sizeof(tmp);
+
+    // 从低位向高位填充
+    while (value >= 100) {
+        unsigned idx = (value % 100) * 2;
+        value /= 100;
+        *--p = digit_pairs[idx + 1];
+        *--p = digit_pairs[idx];
+    }
+    if (value >= 10) {
+        unsigned idx = value * 2;
+        *--p = digit_pairs[idx + 1];
+        *--p = digit_pairs[idx];
+    } else {
+        *--p = '0' + value;
+    }
+    while (tmp + sizeof(tmp) - p < width && p > tmp) {
+        *--p = '0';
+    }
+    http_builder_append(b, p, tmp + sizeof(tmp) - p);
+}
+
+void http_builder_uint(http_builder_t* b, unsigned long value) {
+    http_builder_uint_pad(b, value, 0);
+}
+
+void http_builder_hex(http_builder_t* b, unsigned long value) {
+    static const char hex[] = "0123456789abcdef";
+    char tmp[16];
+    char* p = tmp + sizeof(tmp);
+    do {
+        *--p = hex[value & 0xf];
+        value >>= 4;
+    } while (value);
+    http_builder_append(b, p, tmp + sizeof(tmp) - p);
+}
+
+void http_builder_date(http_builder_t* b, time_t t) {
+    struct tm tm;
+    gmtime_r(&t, &tm);
+
+    // 定长 29 字节：Sun, 06 Nov 1994 08:49:37 GMT
+    char out[29];
+    memcpy(out, day_names[tm.tm_wday], 3);
+    out[3] = ',';
+    out[4] = ' ';
+    memcpy(out + 5, digit_pairs + tm.tm_mday * 2, 2);
+    out[7] = ' ';
+    memcpy(out + 8, month_names[tm.tm_mon], 3);
+    out[11] = ' ';
+    int year = tm.tm_year + 1900;
+    memcpy(out + 12, digit_pairs + (year / 100 % 100) * 2, 2);
+    memcpy(out + 14, digit_pairs + (year % 100) * 2, 2);
+    out[16] = ' ';
+    memcpy(out + 17, digit_pairs + tm.tm_hour * 2, 2);
+    out[19] = ':';
+    memcpy(out + 20, digit_pairs + tm.tm_min * 2, 2);
+    out[22] = ':';
+    memcpy(out + 23, digit_pairs + tm.tm_sec * 2, 2);
+    memcpy(out + 25, " GMT", 4);
+    http_builder_append(b, out, sizeof(out));
+}
@@ -0,0 +1,54 @@
+#ifndef HTTP_BUILDER_H
+#define HTTP_BUILDER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+#include <time.h>
+
+// 响应头构建器：直接写入调用者提供的空间（通常是发送队列中预留的缓冲区），
+// 边写边记录长度，热路径上不使用格式化输出
+typedef struct {
+    char* buf;
+    size_t len;
+    size_t cap;
+    bool overflow;      // 空间不足，之后的写入被丢弃
+} http_builder_t;
+
+static inline void http_builder_init(http_builder_t* b, char* buf, size_t cap) {
+    b->buf = buf;
+    b->len = 0;
+    b->cap = cap;
+    b->overflow = false;
+}
+
+static inline void http_builder_append(http_builder_t* b, const char* data, size_t len) {
+    if (len > b->cap - b->len) {
+        b->overflow = true;
+        return;
+    }
+    memcpy(b->buf + b->len, data, len);
+    b->len += len;
+}
+
+// 字符串字面量的长度在编译期确定
+#define http_builder_literal(b, s) http_builder_append((b), (s), sizeof(s) - 1)
+
+static inline void http_builder_str(http_builder_t* b, const char* s) {
+    http_builder_append(b, s, strlen(s));
+}
+
+// 以 '\0' 结尾，不计入长度；空间不足时标记溢出
+void http_builder_terminate(http_builder_t* b);
+
+// 状态行取自预先计算好长度的表，未知状态码按 500 处理
+void http_builder_status(http_builder_t* b, int status_code);
+// 十进制整数，width 大于位数时左侧补 0
+void http_builder_uint(http_builder_t* b, unsigned long value);
+void http_builder_uint_pad(http_builder_t* b, unsigned long value, int width);
+// 小写十六进制整数
+void http_builder_hex(http_builder_t* b, unsigned long value);
+// RFC 7231 的 IMF-fixdate，例如 Sun, 06 Nov 1994 08:49:37 GMT
+void http_builder_date(http_builder_t* b, time_t t);
+
+#endif
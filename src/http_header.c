@@ -0,0 +1,123 @@
+#include "http_header.h"
+#include "mime.h"
+#include <string.h>
+
+const http_sidecar_t http_sidecars[] = {
+    {"br", ".br"},
+    {"gzip", ".gz"},
+};
+
+const size_t http_sidecar_count = sizeof(http_sidecars) / sizeof(http_sidecars[0]);
+
+// 共用头块按 Connection 取值各保存一份，[0] 为 close，[1] 为 keep-alive
+static struct {
+    char data[HTTP_COMMON_MAX];
+    size_t len;
+} common_blocks[2];
+static time_t common_time;
+
+bool http_is_compressible(const char* content_type) {
+    // image/svg+xml、application/ld+json 等结构化语法后缀同样是文本
+    const char* plus = strrchr(content_type, '+');
+    if (plus && (strcmp(plus, "+xml") == 0 || strcmp(plus, "+json") == 0)) {
+        return true;
+    }
+    return strncmp(content_type, "text/", 5) == 0 ||
+           strcmp(content_type, "application/javascript") == 0 ||
+           strcmp(content_type, "application/json") == 0 ||
+           strcmp(content_type, "application/xml") == 0;
+}
+
+void http_variant_for_file(const char* filename, http_variant_t* v) {
+    v->content_type = mime_lookup(filename);
+    v->encoding = NULL;
+    v->vary = http_is_compressible(v->content_type);
+}
+
+// ETag 由 inode、大小和修改时间组成，文件被替换或修改后随之变化
+void http_format_etag(ino_t ino, off_t size, time_t mtime, char* out, size_t out_size) {
+    http_builder_t b;
+    http_builder_init(&b, out, out_size);
+    http_builder_literal(&b, "\"");
+    http_builder_hex(&b, (unsigned long)ino);
+    http_builder_literal(&b, "-");
+    http_builder_hex(&b, (unsigned long)size);
+    http_builder_literal(&b, "-");
+    http_builder_hex(&b, (unsigned long)mtime);
+    http_builder_literal(&b, "\"");
+    http_builder_terminate(&b);
+}
+
+void http_format_date(time_t t, char* out, size_t out_size) {
+    http_builder_t b;
+    http_builder_init(&b, out, out_size);
+    http_builder_date(&b, t);
+    http_builder_terminate(&b);
+}
+
+void http_build_encoding(http_builder_t* b, const http_variant_t* v) {
+    if (v->encoding) {
+        http_builder_literal(b, "Content-Encoding: ");
+        http_builder_str(b, v->encoding);
+        http_builder_literal(b, "\r\n");
+    }
+    if (v->vary) {
+        http_builder_literal(b, "Vary: Accept-Encoding\r\n");
+    }
+}
+
+void http_build_validators(http_builder_t* b, const char* etag, time_t mtime) {
+    http_builder_literal(b, "ETag: ");
+    http_builder_str(b, etag);
+    http_builder_literal(b, "\r\nLast-Modified: ");
+    http_builder_date(b, mtime);
+    http_builder_literal(b, "\r\n");
+}
+
+void http_common_update(time_t now) {
+    if (now == common_time) {
+        return;
+    }
+    common_time = now;
+
+    for (int keep_alive = 0; keep_alive < 2; keep_alive++) {
+        http_builder_t b;
+        http_builder_init(&b, common_blocks[keep_alive].data, HTTP_COMMON_MAX);
+        http_builder_literal(&b, "Server: " HTTP_SERVER_NAME "\r\nDate: ");
+        http_builder_date(&b, now);
+        if (keep_alive) {
+            http_builder_literal(&b, "\r\nConnection: keep-alive\r\n\r\n");
+        } else {
+            http_builder_literal(&b, "\r\nConnection: close\r\n\r\n");
+        }
+        common_blocks[keep_alive].len = b.len;
+    }
+}
+
+const char* http_common_block(bool keep_alive, size_t* len) {
+    // 事件循环尚未更新过时按当前时间生成
+    if (common_time == 0) {
+        http_common_update(time(NULL));
+    }
+    *len = common_blocks[keep_alive].len;
+    return common_blocks[keep_alive].data;
+}
+
+void http_build_header(http_builder_t* b, const http_variant_t* v, off_t size,
+                       const char* etag, time_t mtime) {
+    http_builder_literal(b, "HTTP/1.1 200 OK\r\nContent-Type: ");
+    http_builder_str(b, v->content_type);
+    http_builder_literal(b, "\r\nContent-Length: ");
+    http_builder_uint(b, (unsigned long)size);
+    http_builder_literal(b, "\r\nAccept-Ranges: bytes\r\n");
+    http_build_encoding(b, v);
+    http_build_validators(b, etag, mtime);
+}
+
+int http_format_header(const http_variant_t* v, off_t size, const char* etag, time_t mtime,
+                       char* out, size_t out_size) {
+    http_builder_t b;
+    http_builder_init(&b, out, out_size);
+    http_build_header(&b, v, size, etag, mtime);
+    return b.overflow ? -1 : (int)b.len;
+}
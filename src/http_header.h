@@ -0,0 +1,55 @@
+#ifndef HTTP_HEADER_H
+#define HTTP_HEADER_H
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <time.h>
+#include <sys/types.h>
+#include "http_builder.h"
+
+#define ETAG_MAX 64
+#define HTTP_DATE_MAX 32
+#define HTTP_DATE_FORMAT "%a, %d %b %Y %H:%M:%S GMT"
+#define HTTP_SERVER_NAME "Liso/1.0"
+#define HTTP_COMMON_MAX 128
+
+// 同一资源的一种表示：原文件或预压缩的旁路文件
+typedef struct {
+    const char* content_type;   // 原文件的 MIME 类型
+    const char* encoding;       // Content-Encoding，原文件为 NULL
+    bool vary;                  // 响应是否随 Accept-Encoding 变化
+} http_variant_t;
+
+// 预压缩旁路文件，按优先级排列
+typedef struct {
+    const char* encoding;
+    const char* suffix;
+} http_sidecar_t;
+
+extern const http_sidecar_t http_sidecars[];
+extern const size_t http_sidecar_count;
+
+// 只对文本类内容使用压缩
+bool http_is_compressible(const char* content_type);
+// 直接请求该文件时的表示，与服务器从文件系统发送时一致：
+// 按扩展名确定类型，旁路文件 file.css.gz 本身为 application/gzip，不带 Content-Encoding
+void http_variant_for_file(const char* filename, http_variant_t* v);
+
+void http_format_etag(ino_t ino, off_t size, time_t mtime, char* out, size_t out_size);
+void http_format_date(time_t t, char* out, size_t out_size);
+// Content-Encoding 和 Vary 头，原文件且不随编码变化时不写入
+void http_build_encoding(http_builder_t* b, const http_variant_t* v);
+// ETag 和 Last-Modified 头
+void http_build_validators(http_builder_t* b, const char* etag, time_t mtime);
+// 每秒更新一次所有响应共用的头块，now 与上次相同时不做任何事
+void http_common_update(time_t now);
+// 响应头的结尾：预渲染的 Server、Date、Connection 头和空行，在下次更新前有效
+const char* http_common_block(bool keep_alive, size_t* len);
+// 200 响应头，不含共用头块
+void http_build_header(http_builder_t* b, const http_variant_t* v, off_t size,
+                       const char* etag, time_t mtime);
+// 同上，写入 out，返回长度，空间不足时返回 -1
+int http_format_header(const http_variant_t* v, off_t size, const char* etag, time_t mtime,
+                       char* out, size_t out_size);
+
+#endif
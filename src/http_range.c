@@ -0,0 +1,137 @@
+#define _GNU_SOURCE
+#include "http_range.h"
+#include <string.h>
+#include <stdlib.h>
+#include <ctype.h>
+#include <errno.h>
+
+static const char *skip_space(const char *p) {
+    while (*p == ' ' || *p == '\t') {
+        p++;
+    }
+    return p;
+}
+
+// 解析一个字节位置；超出 off_t 表示范围的数值返回 false，按超过任何文件长度处理
+static bool parse_pos(const char *p, char **end, off_t *pos) {
+    errno = 0;
+    long long value = strtoll(p, end, 10);
+    if (errno == ERANGE || value != (off_t)value) {
+        return false;
+    }
+    *pos = value;
+    return true;
+}
+
+// 按起点有序加入范围，与已有的重叠或相邻范围合并，超过 max_ranges 时返回 -1
+static int add_range(http_range_t *ranges, int count, int max_ranges, off_t first, off_t last) {
+    int i = 0;
+    while (i < count && ranges[i].end + 1 < first) {
+        i++;
+    }
+    int j = i;
+    while (j < count && ranges[j].start <= last + 1) {
+        if (ranges[j].start < first) {
+            first = ranges[j].start;
+        }
+        if (ranges[j].end > last) {
+            last = ranges[j].end;
+        }
+        j++;
+    }
+
+    // ranges[i, j) 与新范围合并为 ranges[i]
+    if (i == j) {
+        if (count == max_ranges) {
+            return -1;
+        }
+        memmove(&ranges[i + 1], &ranges[i], (count - i) * sizeof(http_range_t));
+        count++;
+    } else {
+        memmove(&ranges[i + 1], &ranges[j], (count - j) * sizeof(http_range_t));
+        count -= j - i - 1;
+    }
+    ranges[i].start = first;
+    ranges[i].end = last;
+    return count;
+}
+
+int http_range_parse(const char *value, off_t size, http_range_t *ranges, int max_ranges) {
+    if (strncasecmp(value, "bytes=", 6) != 0) {
+        return -1;
+    }
+
+    const char *p = value + 6;
+    int count = 0;
+    for (;;) {
+        char *end;
+        off_t first, last;
+
+        p = skip_space(p);
+        if (*p == '-') {
+            // 后缀范围：最后 N 个字节
+            if (!isdigit((unsigned char)p[1])) {
+                return -1;
+            }
+            off_t suffix;
+            bool fits = parse_pos(p + 1, &end, &suffix);
+            first = !fits || suffix >= size ? 0 : size - suffix;
+            last = !fits || suffix > 0 ? size - 1 : -1;
+        } else if (isdigit((unsigned char)*p)) {
+            bool first_fits = parse_pos(p, &end, &first);
+            if (*end != '-') {
+                return -1;
+            }
+            end++;
+            if (isdigit((unsigned char)*end)) {
+                bool last_fits = parse_pos(end, &end, &last);
+                if (!first_fits && last_fits) {
+                    return -1;
+                }
+                if (first_fits && last_fits && last < first) {
+                    return -1;
+                }
+                if (!last_fits || last >= size) {
+                    last = size - 1;
+                }
+            } else {
+                last = size - 1;
+            }
+            // 起点溢出的范围不可满足
+            if (!first_fits) {
+                first = last + 1;
+            }
+        } else {
+            return -1;
+        }
+        p = skip_space(end);
+
+        // 起点超出文件的范围不可满足，跳过；重复的范围合并后不会多次发送同一段内容
+        if (first <= last && (count = add_range(ranges, count, max_ranges, first, last)) < 0) {
+            return -1;
+        }
+
+        if (*p == '\0') {
+            break;
+        }
+        if (*p++ != ',') {
+            return -1;
+        }
+    }
+    return count;
+}
+
+bool http_range_if_range(const char *value, const char *etag, time_t mtime) {
+    value = skip_space(value);
+    if (*value == '"') {
+        return strcmp(value, etag) == 0;
+    }
+    if (strncmp(value, "W/", 2) == 0) {
+        return false;
+    }
+
+    struct tm tm;
+    memset(&tm, 0, sizeof(tm));
+    const char *end = strptime(value, "%a, %d %b %Y %H:%M:%S GMT", &tm);
+    return end && *end == '\0' && timegm(&tm) == mtime;
+}
@@ -0,0 +1,23 @@
+#ifndef HTTP_RANGE_H
+#define HTTP_RANGE_H
+
+#include <stdbool.h>
+#include <time.h>
+#include <sys/types.h>
+
+#define HTTP_RANGE_MAX 16 // 单个请求最多处理的范围数，超过时忽略 Range 头
+
+// 字节范围，闭区间 [start, end]
+typedef struct {
+    off_t start;
+    off_t end;
+} http_range_t;
+
+// 解析 Range 头，返回可满足的范围个数；0 表示没有可满足的范围（应返回 416），
+// -1 表示语法无效或范围过多，按 RFC 7233 忽略该头返回完整内容。
+// 重叠或相邻的范围合并，结果按起点排序
+int http_range_parse(const char *value, off_t size, http_range_t *ranges, int max_ranges);
+// If-Range 是否与当前资源的 ETag 或 Last-Modified 一致，只使用强比较
+bool http_range_if_range(const char *value, const char *etag, time_t mtime);
+
+#endif
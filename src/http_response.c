@@ -1,168 +1,1028 @@
+#define _GNU_SOURCE
 #include "http_response.h"
+#include "http_range.h"
+#include "http_builder.h"
+#include "compress.h"
+#include "mime.h"
+#include "splice_stream.h"
+#include "config.h"
+#include "mem_stats.h"
 #include "logger.h"
 #include <string.h>
-#include <stdio.h>
+#include <time.h>
 #include <sys/stat.h>
 #include <unistd.h>
-#include <sys/socket.h>
+#include <fcntl.h>
 #include <errno.h>
 
 #define BUF_SIZE 4096
+#define INLINE_BODY_MAX (16 * 1024) // 不超过该大小的文件内容随响应头一起发送
+#define PART_HEADER_MAX 256
+#define BOUNDARY_LEN 20
+#define HTTP_HEADER_RESERVE 1024    // 构建响应头时在发送队列中预留的空间
+#define IMMUTABLE_MAX_AGE 31536000  // 指纹路径的缓存时间，一年
 
-// MIME 类型定义
-static const struct mime_type mime_types[] = {
-    {".html", "text/html"},
-    {".htm", "text/html"},
-    {".css", "text/css"},
-    {".js", "application/javascript"},
-    {".json", "application/json"},
-    {".jpg", "image/jpeg"},
-    {".jpeg", "image/jpeg"},
-    {".png", "image/png"},
-    {".gif", "image/gif"},
-    {".ico", "image/x-icon"},
-    {".xml", "application/xml"},
-    {".pdf", "application/pdf"},
-    {".txt", "text/plain"},
-    {NULL, NULL}
-};
-
-// 状态码响应
-static const char* get_status_message(int status_code) {
-    switch (status_code) {
-        case HTTP_STATUS_OK:
-            return "HTTP/1.1 200 OK\r\n";
-        case HTTP_STATUS_BAD_REQUEST:
-            return "HTTP/1.1 400 Bad Request\r\n\r\n";
-        case HTTP_STATUS_NOT_FOUND:
-            return "HTTP/1.1 404 Not Found\r\n\r\n";
-        case HTTP_STATUS_INTERNAL_ERROR:
-            return "HTTP/1.1 500 Internal Server Error\r\n\r\n";
-        case HTTP_STATUS_NOT_IMPLEMENTED:
-            return "HTTP/1.1 501 Not Implemented\r\n\r\n";
-        case HTTP_STATUS_VERSION_NOT_SUPPORTED:
-            return "HTTP/1.1 505 HTTP Version Not Supported\r\n\r\n";
-        default:
-            return "HTTP/1.1 500 Internal Server Error\r\n\r\n";
-    }
-}
-
-// 发送文件
-static void http_send_file(int client_sock, const char* filepath, bool head_only) {
-    struct stat file_stat;
-    if (stat(filepath, &file_stat) != 0) {
-        LOG_ERROR("File not found: %s", filepath);
-        http_send_status(client_sock, HTTP_STATUS_NOT_FOUND);
+// 在发送队列中预留空间，响应头直接构建在连接的发送缓冲区中
+static bool http_reserve(http_ctx_t* ctx, http_builder_t* b) {
+    char* dst = send_queue_reserve(ctx->out, HTTP_HEADER_RESERVE);
+    if (!dst) {
+        return false;
+    }
+    http_builder_init(b, dst, HTTP_HEADER_RESERVE);
+    return true;
+}
+
+// 响应只有一部分进入了发送队列，后续响应无法正确分帧：发送已入队的部分后关闭连接
+static void http_abort(http_ctx_t* ctx) {
+    ctx->keep_alive = false;
+}
+
+// 预留空间并写入状态行
+static bool http_begin(http_ctx_t* ctx, http_builder_t* b, int status_code) {
+    if (!http_reserve(ctx, b)) {
+        return false;
+    }
+    http_builder_status(b, status_code);
+    return true;
+}
+
+// 追加共用的 Server、Date、Connection 头和空行，提交构建好的响应头
+static bool http_commit(http_ctx_t* ctx, http_builder_t* b) {
+    size_t tail_len;
+    const char* tail = http_common_block(ctx->keep_alive, &tail_len);
+    http_builder_append(b, tail, tail_len);
+    if (b->overflow) {
+        send_queue_commit(ctx->out, 0);
+        return false;
+    }
+    return send_queue_commit(ctx->out, b->len);
+}
+
+// 指纹路径的内容与 URL 一一对应，可以永久缓存；其他路径只缓存 --max-age 秒
+// 两种取值在启动后不变，首次使用时格式化
+static const char* http_cache_control(const http_ctx_t* ctx, size_t* len) {
+    static char lines[2][64];
+    static size_t lens[2];
+    int i = ctx->immutable ? 1 : 0;
+    if (lens[i] == 0) {
+        http_builder_t b;
+        http_builder_init(&b, lines[i], sizeof(lines[i]));
+        http_builder_literal(&b, "Cache-Control: ");
+        if (ctx->immutable) {
+            http_builder_literal(&b, "immutable, ");
+        }
+        http_builder_literal(&b, "max-age=");
+        http_builder_uint(&b, ctx->immutable ? IMMUTABLE_MAX_AGE : (unsigned long)g_config.max_age);
+        http_builder_literal(&b, "\r\n");
+        lens[i] = b.len;
+    }
+    *len = lens[i];
+    return lines[i];
+}
+
+static void http_build_cache_control(http_builder_t* b, const http_ctx_t* ctx) {
+    size_t len;
+    const char* line = http_cache_control(ctx, &len);
+    http_builder_append(b, line, len);
+}
+
+// Accept-Encoding 是否接受 coding：显式列出且 q 不为 0，或未列出但 * 的 q 不为 0
+static bool http_accepts_encoding(const char* value, const char* coding) {
+    size_t coding_len = strlen(coding);
+    int star = -1;
+    const char* p = value;
+
+    while (*p) {
+        while (*p == ' ' || *p == '\t' || *p == ',') {
+            p++;
+        }
+        const char* start = p;
+        while (*p && *p != ',' && *p != ';' && *p != ' ' && *p != '\t') {
+            p++;
+        }
+        size_t len = p - start;
+
+        // 参数中只关心 q 值
+        bool accepted = true;
+        while (*p && *p != ',') {
+            if (*p++ != ';') {
+                continue;
+            }
+            while (*p == ' ' || *p == '\t') {
+                p++;
+            }
+            if ((*p == 'q' || *p == 'Q') && p[1] == '=') {
+                accepted = strtod(p + 2, NULL) > 0;
+            }
+        }
+
+        if (len == coding_len && strncasecmp(start, coding, len) == 0) {
+            return accepted;
+        }
+        if (len == 1 && *start == '*') {
+            star = accepted;
+        }
+    }
+    return star == 1;
+}
+
+// If-None-Match 列表中是否有与 etag 匹配的项，按弱比较忽略 W/ 前缀
+static bool http_etag_matches(const char* list, const char* etag) {
+    size_t etag_len = strlen(etag);
+    const char* p = list;
+
+    while (*p) {
+        while (*p == ' ' || *p == '\t' || *p == ',') {
+            p++;
+        }
+        if (*p == '*') {
+            return true;
+        }
+        if (strncmp(p, "W/", 2) == 0) {
+            p += 2;
+        }
+        const char* start = p;
+        while (*p && *p != ',' && *p != ' ' && *p != '\t') {
+            p++;
+        }
+        if ((size_t)(p - start) == etag_len && strncmp(start, etag, etag_len) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// 按 If-None-Match / If-Modified-Since 判断客户端缓存的副本是否仍然有效
+// 两者同时存在时只看 If-None-Match
+static bool http_not_modified(const http_ctx_t* ctx, const char* etag, time_t mtime) {
+    if (!ctx->request) {
+        return false;
+    }
+
+    const char* if_none_match = request_get_header(ctx->request, "If-None-Match");
+    if (if_none_match) {
+        return http_etag_matches(if_none_match, etag);
+    }
+
+    const char* if_modified_since = request_get_header(ctx->request, "If-Modified-Since");
+    if (if_modified_since) {
+        struct tm tm;
+        memset(&tm, 0, sizeof(tm));
+        const char* end = strptime(if_modified_since, HTTP_DATE_FORMAT, &tm);
+        if (!end || *end != '\0') {
+            return false;
+        }
+        // 晚于服务器当前时间的日期无效，忽略该头（RFC 9110 13.1.3）
+        time_t since = timegm(&tm);
+        return since <= time(NULL) && mtime <= since;
+    }
+    return false;
+}
+
+// 304 响应只包含校验器，不读取文件
+static void http_send_not_modified(http_ctx_t* ctx, const char* path, const http_variant_t* v,
+                                   const char* etag, time_t mtime) {
+    http_builder_t b;
+    bool ok = http_begin(ctx, &b, HTTP_STATUS_NOT_MODIFIED);
+    if (ok) {
+        http_build_validators(&b, etag, mtime);
+        http_build_cache_control(&b, ctx);
+        if (v->vary) {
+            http_builder_literal(&b, "Vary: Accept-Encoding\r\n");
+        }
+        ok = http_commit(ctx, &b);
+    }
+    if (!ok) {
+        http_abort(ctx);
+        LOG_ERROR("Failed to queue 304 response: %s", path);
         return;
     }
+    send_queue_end_response(ctx->out);
+    LOG_INFO("Queued 304 response for: %s", path);
+}
+
+// 响应体来源：内存中的内容或打开的文件
+typedef struct {
+    FileCacheEntry* entry;      // 内存内容所属的缓存条目，pack 映像中的内容为 NULL
+    OpenFileEntry* file;        // 非空时通过 sendfile 发送
+    const char* data;           // 内存中的内容
+} body_source_t;
+
+// 内存中的完整资源：文件缓存条目或 pack 映像中的文件
+typedef struct {
+    const char* header;         // 直接请求该路径时的响应头，不含 Connection 头；为 NULL 时按表示生成
+    size_t header_len;
+    const char* body;
+    size_t body_len;
+    ino_t ino;
+    time_t mtime;
+    FileCacheEntry* entry;      // 所属的缓存条目，pack 映像中的资源为 NULL
+} http_resource_t;
+
+// 引用内存中的数据，数据属于缓存条目时该段持有一个引用
+static bool http_append_ref(http_ctx_t* ctx, FileCacheEntry* entry, const char* data, size_t len) {
+    if (!entry) {
+        return send_queue_append_ref(ctx->out, data, len, NULL, NULL);
+    }
+    file_cache_retain(entry);
+    return send_queue_append_ref(ctx->out, data, len, file_cache_release, entry);
+}
+
+// 文件区间开头不在页缓存中时提交预读，返回的任务用于推迟发送；已常驻或未启用预读时返回 NULL
+static PrefetchJob* http_prefetch(http_ctx_t* ctx, OpenFileEntry* file, off_t start, size_t len) {
+    Prefetcher* prefetch = ctx->cache->prefetch;
+    return prefetch ? prefetch_check(prefetch, file, start, len) : NULL;
+}
+
+// 将内容的一段加入发送队列，每个段各持有一个引用
+static bool http_append_body(http_ctx_t* ctx, const body_source_t* src, off_t start, size_t len) {
+    if (src->file) {
+        PrefetchJob* job = http_prefetch(ctx, src->file, start, len);
+        open_file_cache_retain(src->file);
+        if (!send_queue_append_file_ref(ctx->out, src->file->fd, start, len,
+                                        open_file_cache_release, src->file)) {
+            prefetch_release(job);
+            return false;
+        }
+        if (job) {
+            send_queue_wait_prefetch(ctx->out, job);
+        }
+        return true;
+    }
+    return http_append_ref(ctx, src->entry, src->data + start, len);
+}
+
+// 处理 Range 请求，已发送 206/416 时返回 true；返回 false 时调用者发送完整内容，
+// 416 响应无法入队时同样返回 false
+// 多个范围使用 multipart/byteranges，分段头写入发送队列，内容仍按偏移从缓存或文件发送
+static bool http_send_ranges(http_ctx_t* ctx, const char* path, const http_variant_t* v,
+                             const body_source_t* src, off_t size, const char* etag, time_t mtime) {
+    const char* range = ctx->request ? request_get_header(ctx->request, "Range") : NULL;
+    if (!range) {
+        return false;
+    }
+    const char* if_range = request_get_header(ctx->request, "If-Range");
+    if (if_range && !http_range_if_range(if_range, etag, mtime)) {
+        return false;
+    }
+
+    http_range_t ranges[HTTP_RANGE_MAX];
+    int count = http_range_parse(range, size, ranges, HTTP_RANGE_MAX);
+    if (count < 0) {
+        return false;
+    }
+
+    http_builder_t b;
+    if (count == 0) {
+        bool ok = http_begin(ctx, &b, HTTP_STATUS_RANGE_NOT_SATISFIABLE);
+        if (ok) {
+            http_builder_literal(&b, "Content-Range: bytes */");
+            http_builder_uint(&b, size);
+            http_builder_literal(&b, "\r\nContent-Length: 0\r\n");
+            ok = http_commit(ctx, &b);
+        }
+        if (!ok) {
+            // 没有内容入队，由调用者发送完整内容
+            http_abort(ctx);
+            LOG_ERROR("Failed to queue 416 response: %s", path);
+            return false;
+        }
+        send_queue_end_response(ctx->out);
+        LOG_INFO("Queued 416 response for: %s", path);
+        return true;
+    }
 
-    if (!S_ISREG(file_stat.st_mode)) {
-        LOG_ERROR("Not a regular file: %s", filepath);
-        http_send_status(client_sock, HTTP_STATUS_NOT_FOUND);
+    const char* content_type = v->content_type;
+    if (count == 1) {
+        size_t len = ranges[0].end - ranges[0].start + 1;
+        bool ok = http_begin(ctx, &b, HTTP_STATUS_PARTIAL_CONTENT);
+        if (ok) {
+            http_builder_literal(&b, "Content-Type: ");
+            http_builder_str(&b, content_type);
+            http_builder_literal(&b, "\r\nContent-Length: ");
+            http_builder_uint(&b, len);
+            http_builder_literal(&b, "\r\nContent-Range: bytes ");
+            http_builder_uint(&b, ranges[0].start);
+            http_builder_literal(&b, "-");
+            http_builder_uint(&b, ranges[0].end);
+            http_builder_literal(&b, "/");
+            http_builder_uint(&b, size);
+            http_builder_literal(&b, "\r\n");
+            http_build_encoding(&b, v);
+            http_build_validators(&b, etag, mtime);
+            http_build_cache_control(&b, ctx);
+            ok = http_commit(ctx, &b);
+        }
+        if (!ok || !http_append_body(ctx, src, ranges[0].start, len)) {
+            http_abort(ctx);
+            LOG_ERROR("Failed to queue range response: %s", path);
+            return true;
+        }
+        send_queue_end_response(ctx->out);
+        LOG_INFO("Queued range %ld-%ld of: %s", (long)ranges[0].start, (long)ranges[0].end, path);
+        return true;
+    }
+
+    // 先生成所有分段头以计算 Content-Length
+    static unsigned long boundary_seq;
+    char boundary[BOUNDARY_LEN];
+    http_builder_init(&b, boundary, sizeof(boundary));
+    http_builder_uint_pad(&b, ++boundary_seq, BOUNDARY_LEN);
+
+    char parts[HTTP_RANGE_MAX][PART_HEADER_MAX];
+    size_t part_lens[HTTP_RANGE_MAX];
+    char trailer[BOUNDARY_LEN + 8];
+    http_builder_init(&b, trailer, sizeof(trailer));
+    http_builder_literal(&b, "\r\n--");
+    http_builder_append(&b, boundary, BOUNDARY_LEN);
+    http_builder_literal(&b, "--\r\n");
+    size_t trailer_len = b.len;
+    size_t content_length = trailer_len;
+    for (int i = 0; i < count; i++) {
+        http_builder_init(&b, parts[i], PART_HEADER_MAX);
+        http_builder_literal(&b, "\r\n--");
+        http_builder_append(&b, boundary, BOUNDARY_LEN);
+        http_builder_literal(&b, "\r\nContent-Type: ");
+        http_builder_str(&b, content_type);
+        http_builder_literal(&b, "\r\nContent-Range: bytes ");
+        http_builder_uint(&b, ranges[i].start);
+        http_builder_literal(&b, "-");
+        http_builder_uint(&b, ranges[i].end);
+        http_builder_literal(&b, "/");
+        http_builder_uint(&b, size);
+        http_builder_literal(&b, "\r\n\r\n");
+        if (b.overflow) {
+            LOG_ERROR("Range part header too large: %s", path);
+            http_send_status(ctx, HTTP_STATUS_INTERNAL_ERROR);
+            return true;
+        }
+        part_lens[i] = b.len;
+        content_length += part_lens[i] + (ranges[i].end - ranges[i].start + 1);
+    }
+
+    bool ok = http_begin(ctx, &b, HTTP_STATUS_PARTIAL_CONTENT);
+    if (ok) {
+        http_builder_literal(&b, "Content-Type: multipart/byteranges; boundary=");
+        http_builder_append(&b, boundary, BOUNDARY_LEN);
+        http_builder_literal(&b, "\r\nContent-Length: ");
+        http_builder_uint(&b, content_length);
+        http_builder_literal(&b, "\r\n");
+        http_build_encoding(&b, v);
+        http_build_validators(&b, etag, mtime);
+        http_build_cache_control(&b, ctx);
+        ok = http_commit(ctx, &b);
+    }
+    if (!ok) {
+        http_abort(ctx);
+        LOG_ERROR("Failed to queue range response: %s", path);
+        return true;
+    }
+    for (int i = 0; i < count; i++) {
+        if (!send_queue_append(ctx->out, parts[i], part_lens[i]) ||
+            !http_append_body(ctx, src, ranges[i].start, ranges[i].end - ranges[i].start + 1)) {
+            http_abort(ctx);
+            LOG_ERROR("Failed to queue range response: %s", path);
+            return true;
+        }
+    }
+    if (!send_queue_append(ctx->out, trailer, trailer_len)) {
+        http_abort(ctx);
+        LOG_ERROR("Failed to queue range response: %s", path);
+        return true;
+    }
+    send_queue_end_response(ctx->out);
+    LOG_INFO("Queued %d ranges of: %s", count, path);
+    return true;
+}
+
+// 发送内存中的完整响应，响应头不含随请求变化的 Cache-Control 和共用头，按请求补上
+static void http_send_cached(http_ctx_t* ctx, const char* path, const http_variant_t* v,
+                             const http_resource_t* res, const char* etag, bool head_only) {
+    bool ok;
+    if (res->header) {
+        size_t cc_len;
+        size_t tail_len;
+        const char* cc = http_cache_control(ctx, &cc_len);
+        const char* tail = http_common_block(ctx->keep_alive, &tail_len);
+
+        // 只预留这两段的长度，发送缓冲区剩余空间不多时也不必退回堆分配
+        ok = http_append_ref(ctx, res->entry, res->header, res->header_len);
+        char* dst = ok ? send_queue_reserve(ctx->out, cc_len + tail_len) : NULL;
+        if (dst) {
+            memcpy(dst, cc, cc_len);
+            memcpy(dst + cc_len, tail, tail_len);
+            ok = send_queue_commit(ctx->out, cc_len + tail_len);
+        } else {
+            ok = false;
+        }
+    } else {
+        http_builder_t b;
+        ok = http_reserve(ctx, &b);
+        if (ok) {
+            http_build_header(&b, v, res->body_len, etag, res->mtime);
+            http_build_cache_control(&b, ctx);
+            ok = http_commit(ctx, &b);
+        }
+    }
+    if (ok && !head_only && res->body_len > 0) {
+        ok = http_append_ref(ctx, res->entry, res->body, res->body_len);
+    }
+
+    if (!ok) {
+        http_abort(ctx);
+        LOG_ERROR("Failed to queue cached response: %s", path);
         return;
     }
+    send_queue_end_response(ctx->out);
+    LOG_INFO("Queued cached %s response for: %s", head_only ? "HEAD" : "GET", path);
+}
 
-    FILE* file = fopen(filepath, "rb");
-    if (!file) {
-        LOG_ERROR("Cannot open file: %s (%s)", filepath, strerror(errno));
-        http_send_status(client_sock, HTTP_STATUS_INTERNAL_ERROR);
+// 发送内存中资源的完整、部分内容或 304 响应
+static void http_send_resource(http_ctx_t* ctx, const char* path, const http_variant_t* v,
+                               const http_resource_t* res, bool head_only) {
+    char etag[ETAG_MAX];
+    http_format_etag(res->ino, res->body_len, res->mtime, etag, sizeof(etag));
+    if (http_not_modified(ctx, etag, res->mtime)) {
+        http_send_not_modified(ctx, path, v, etag, res->mtime);
         return;
     }
 
-    // 构建响应头
-    const char* content_type = http_get_mime_type(filepath);
-    char header[BUF_SIZE];
-    snprintf(header, BUF_SIZE,
-             "HTTP/1.1 200 OK\r\n"
-             "Content-Type: %s\r\n"
-             "Content-Length: %ld\r\n"
-             "Connection: close\r\n"
-             "\r\n",
-             content_type,
-             file_stat.st_size);
-
-    // 发送响应头
-    if (send(client_sock, header, strlen(header), 0) < 0) {
-        LOG_ERROR("Failed to send file response header: %s", strerror(errno));
-        fclose(file);
+    body_source_t src = {res->entry, NULL, res->body};
+    if (!head_only && http_send_ranges(ctx, path, v, &src, res->body_len, etag, res->mtime)) {
         return;
     }
+    http_send_cached(ctx, path, v, res, etag, head_only);
+}
 
-    // 如果是 HEAD 请求，到此结束
-    if (head_only) {
-        LOG_INFO("Sent HEAD response for: %s", filepath);
-        fclose(file);
+// 从缓存条目发送响应，消耗调用者持有的引用；
+// 条目保存的是直接请求该路径时的响应头，作为原文件的压缩表示发送时按 v 重新生成
+static void http_send_entry(http_ctx_t* ctx, const char* path, const http_variant_t* v,
+                            FileCacheEntry* entry, bool head_only) {
+    http_resource_t res = {
+        v->encoding ? NULL : entry->data, entry->header_len,
+        entry->data + entry->header_len, entry->body_len,
+        entry->ino, entry->mtime,
+        entry,
+    };
+    http_send_resource(ctx, path, v, &res, head_only);
+    file_cache_release(entry);
+}
+
+// 将响应头和文件内容写入发送队列中同一段连续内存
+static void http_send_inline(http_ctx_t* ctx, const http_variant_t* v, const OpenFileEntry* file,
+                             const char* etag) {
+    char* dst = send_queue_reserve(ctx->out, HTTP_HEADER_RESERVE + file->size);
+    if (!dst) {
+        LOG_ERROR("Failed to reserve response buffer: %s", file->path);
+        http_send_status(ctx, HTTP_STATUS_INTERNAL_ERROR);
         return;
     }
 
-    // 发送文件内容
-    char buf[BUF_SIZE];
-    size_t bytes_read;
-    size_t total_sent = 0;
+    // 响应头直接写在预留空间的开头，文件内容紧随其后
+    size_t tail_len;
+    const char* tail = http_common_block(ctx->keep_alive, &tail_len);
+    http_builder_t b;
+    http_builder_init(&b, dst, HTTP_HEADER_RESERVE);
+    http_build_header(&b, v, file->size, etag, file->mtime);
+    http_build_cache_control(&b, ctx);
+    http_builder_append(&b, tail, tail_len);
+    if (b.overflow) {
+        LOG_ERROR("Response header too large: %s", file->path);
+        send_queue_commit(ctx->out, 0);
+        http_send_status(ctx, HTTP_STATUS_INTERNAL_ERROR);
+        return;
+    }
 
-    while ((bytes_read = fread(buf, 1, BUF_SIZE, file)) > 0) {
-        ssize_t bytes_sent = send(client_sock, buf, bytes_read, 0);
-        if (bytes_sent < 0) {
-            LOG_ERROR("Failed to send file content: %s", strerror(errno));
-            break;
+    size_t total = b.len + file->size;
+    char* body = dst + b.len;
+    size_t done = 0;
+    while (done < (size_t)file->size) {
+        ssize_t n = pread(file->fd, body + done, file->size - done, done);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            LOG_ERROR("Error reading file: %s", file->path);
+            send_queue_commit(ctx->out, 0);
+            http_send_status(ctx, HTTP_STATUS_INTERNAL_ERROR);
+            return;
         }
-        total_sent += bytes_sent;
+        done += n;
     }
 
-    if (ferror(file)) {
-        LOG_ERROR("Error reading file: %s", filepath);
-    } else {
-        LOG_INFO("Sent file: %s, total bytes: %zu", filepath, total_sent);
+    if (!send_queue_commit(ctx->out, total)) {
+        http_abort(ctx);
+        LOG_ERROR("Failed to queue file response: %s", file->path);
+        return;
+    }
+    send_queue_end_response(ctx->out);
+    LOG_INFO("Queued file: %s, total bytes: %ld", file->path, file->size);
+}
+
+// 发送长度未知的内容：HTTP/1.1 使用分块编码，HTTP/1.0 发送完毕后关闭连接；
+// 没有长度和校验器，不支持条件请求和范围请求
+static void http_send_stream(http_ctx_t* ctx, const char* filepath, const http_variant_t* v,
+                             bool head_only) {
+    bool chunked = ctx->request && strcmp(ctx->request->http_version, "HTTP/1.1") == 0;
+    if (!chunked) {
+        ctx->keep_alive = false;
+    }
+
+    // 每个响应单独打开，管道和设备没有可共享的读取位置
+    SpliceStream* stream = NULL;
+    if (!head_only) {
+        int fd = open(filepath, O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+        if (fd < 0 || !(stream = splice_stream_create(filepath, fd, chunked))) {
+            LOG_ERROR("Cannot open stream: %s (%s)", filepath, strerror(errno));
+            http_send_status(ctx, HTTP_STATUS_INTERNAL_ERROR);
+            return;
+        }
+    }
+
+    http_builder_t b;
+    bool ok = http_begin(ctx, &b, HTTP_STATUS_OK);
+    if (ok) {
+        http_builder_literal(&b, "Content-Type: ");
+        http_builder_str(&b, v->content_type);
+        http_builder_literal(&b, "\r\n");
+        if (chunked) {
+            http_builder_literal(&b, "Transfer-Encoding: chunked\r\n");
+        }
+        ok = http_commit(ctx, &b);
+    }
+    if (!ok) {
+        http_abort(ctx);
+        LOG_ERROR("Failed to queue stream response header: %s", filepath);
+        splice_stream_destroy(stream);
+        return;
     }
 
-    fclose(file);
+    if (stream && !send_queue_append_stream(ctx->out, stream)) {
+        http_abort(ctx);
+        LOG_ERROR("Failed to queue stream: %s", filepath);
+        return;
+    }
+    send_queue_end_response(ctx->out);
+    LOG_INFO("Queued %s stream for: %s", chunked ? "chunked" : "close-delimited", filepath);
 }
 
+// 发送文件的一种表示；optional 为 true 且文件不存在时不发送响应，返回 false
+// 调用者已查过文件缓存时 lookup 为 false，不再重复查找
+static bool http_send_variant(http_ctx_t* ctx, const char* filepath, const http_variant_t* v,
+                              bool head_only, bool optional, bool lookup) {
+    FileCache* cache = ctx->cache;
+
+    // pack 映像中的文件不访问文件系统，也不占用文件缓存
+    const struct pack_entry* packed = cache->pack ? pack_lookup(cache->pack, filepath) : NULL;
+    if (packed) {
+        http_resource_t res = {
+            v->encoding ? NULL : pack_data(cache->pack, packed->header_offset), packed->header_len,
+            pack_data(cache->pack, packed->body_offset), packed->body_len,
+            packed->ino, packed->mtime,
+            NULL,
+        };
+        http_send_resource(ctx, filepath, v, &res, head_only);
+        return true;
+    }
+
+    // 缓存命中时不访问文件系统
+    char etag[ETAG_MAX];
+    FileCacheEntry* entry = lookup ? file_cache_lookup(cache, filepath) : NULL;
+    if (entry) {
+        http_send_entry(ctx, filepath, v, entry, head_only);
+        return true;
+    }
+
+    // 通过打开文件缓存获取 fd 和 stat 信息，失败结果同样被缓存
+    OpenFileEntry* file = open_file_cache_get(cache->open_files, filepath);
+    if (!file) {
+        LOG_ERROR("Failed to allocate open file entry: %s", filepath);
+        http_send_status(ctx, HTTP_STATUS_INTERNAL_ERROR);
+        return true;
+    }
+
+    // 目录等不提供服务的文件类型按不存在处理
+    bool missing = (file->err == ENOENT || file->err == ENOTDIR) ||
+                   (file->err == EACCES && file->mode != 0 && !S_ISREG(file->mode));
+    if (optional && missing) {
+        open_file_cache_release(file);
+        return false;
+    }
+
+    if (file->err) {
+        if (missing) {
+            LOG_ERROR("File not found: %s", filepath);
+            http_send_status(ctx, HTTP_STATUS_NOT_FOUND);
+        } else {
+            LOG_ERROR("Cannot open file: %s (%s)", filepath, strerror(file->err));
+            http_send_status(ctx, HTTP_STATUS_INTERNAL_ERROR);
+        }
+        open_file_cache_release(file);
+        return true;
+    }
+
+    // 管道和字符设备无法 sendfile，经 splice 流式发送
+    if (S_ISFIFO(file->mode) || S_ISCHR(file->mode)) {
+        open_file_cache_release(file);
+        http_send_stream(ctx, filepath, v, head_only);
+        return true;
+    }
+
+    http_format_etag(file->ino, file->size, file->mtime, etag, sizeof(etag));
+    if (http_not_modified(ctx, etag, file->mtime)) {
+        http_send_not_modified(ctx, filepath, v, etag, file->mtime);
+        open_file_cache_release(file);
+        return true;
+    }
+
+    // 范围请求直接按偏移发送，不读入缓存
+    body_source_t src = {NULL, file, NULL};
+    if (!head_only && http_send_ranges(ctx, filepath, v, &src, file->size, etag, file->mtime)) {
+        open_file_cache_release(file);
+        return true;
+    }
+
+    // 文件不在页缓存中时不在事件循环中读取：跳过缓存和内联发送，
+    // 响应头先入队，内容等后台预读完成后再通过 sendfile 发送
+    PrefetchJob* job = head_only ? NULL : http_prefetch(ctx, file, 0, file->size);
+
+    // 小文件读入缓存，与直接请求该路径时的响应头一起保存，旁路文件与 pack 映像一样
+    // 保存其自身的类型；共用头块随每个请求不同，发送时追加
+    http_variant_t direct;
+    char header[BUF_SIZE];
+    int header_len = -1;
+    if (!job && file_cache_admits(cache, file->size)) {
+        if (v->encoding) {
+            http_variant_for_file(filepath, &direct);
+        } else {
+            direct = *v;
+        }
+        header_len = http_format_header(&direct, file->size, etag, file->mtime, header, sizeof(header));
+    }
+    if (header_len >= 0) {
+        entry = file_cache_insert(cache, filepath, header, header_len, file);
+        if (entry) {
+            entry->content_type = direct.content_type;
+            open_file_cache_release(file);
+            http_send_entry(ctx, filepath, v, entry, head_only);
+            return true;
+        }
+    }
+
+    // 未缓存的小文件直接读到响应头之后，与响应头一起用一次 sendmsg 发出
+    if (!job && !head_only && file->size > 0 && file->size <= INLINE_BODY_MAX) {
+        http_send_inline(ctx, v, file, etag);
+        open_file_cache_release(file);
+        return true;
+    }
+
+    http_builder_t b;
+    bool ok = http_reserve(ctx, &b);
+    if (ok) {
+        http_build_header(&b, v, file->size, etag, file->mtime);
+        http_build_cache_control(&b, ctx);
+        ok = http_commit(ctx, &b);
+    }
+    if (!ok) {
+        http_abort(ctx);
+        LOG_ERROR("Failed to queue file response header: %s", filepath);
+        prefetch_release(job);
+        open_file_cache_release(file);
+        return true;
+    }
+
+    // 如果是 HEAD 请求，到此结束
+    if (head_only || file->size == 0) {
+        prefetch_release(job);
+        open_file_cache_release(file);
+        send_queue_end_response(ctx->out);
+        LOG_INFO("Queued %s response for: %s", head_only ? "HEAD" : "empty file", filepath);
+        return true;
+    }
+
+    // 文件内容由发送队列通过 sendfile 从缓存的 fd 直接发送，发送完成后释放引用
+    if (!send_queue_append_file_ref(ctx->out, file->fd, 0, file->size,
+                                    open_file_cache_release, file)) {
+        http_abort(ctx);
+        LOG_ERROR("Failed to queue file content: %s", filepath);
+        prefetch_release(job);
+        return true;
+    }
+    if (job) {
+        send_queue_wait_prefetch(ctx->out, job);
+    }
+
+    send_queue_end_response(ctx->out);
+    LOG_INFO("Queued file: %s, total bytes: %ld", filepath, file->size);
+    return true;
+}
+
+
+// 待压缩的原文件：pack 映像中的内容或打开的文件
+typedef struct {
+    const char* data;           // pack 映像中的内容，为 NULL 时从 file 读取
+    const OpenFileEntry* file;
+    size_t size;
+    ino_t ino;
+    time_t mtime;
+} gzip_source_t;
+
+// 读取文件并压缩，结果放入压缩变体缓存；压缩无收益时缓存一个不含响应头的空条目，
+// 之后的请求直接发送原文件而不再重复压缩
+static FileCacheEntry* http_compress_file(FileCache* variants, const char* filepath,
+                                          const http_variant_t* v, const gzip_source_t* src) {
+    size_t size = src->size;
+    char* buf = src->data ? NULL : mem_malloc(MEM_TAG_COMPRESS, size);
+    char* out = mem_malloc(MEM_TAG_COMPRESS, size);
+    const char* in = src->data ? src->data : buf;
+    FileCacheEntry* entry = NULL;
+    if (!in || !out) {
+        goto out;
+    }
+
+    size_t done = src->data ? size : 0;
+    while (done < size) {
+        ssize_t n = pread(src->file->fd, buf + done, size - done, done);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            LOG_ERROR("Error reading file for compression: %s", filepath);
+            goto out;
+        }
+        done += n;
+    }
+
+    ssize_t out_len = compress_gzip(in, size, g_config.gzip_level, out, size);
+    compress_stats_record(v->content_type, size, out_len < 0 ? size : (size_t)out_len);
+    if (out_len < 0) {
+        entry = file_cache_insert_data(variants, filepath, "", 0, "", 0, src->ino, src->mtime);
+        goto out;
+    }
+
+    char etag[ETAG_MAX];
+    char header[BUF_SIZE];
+    http_format_etag(src->ino, out_len, src->mtime, etag, sizeof(etag));
+    int header_len = http_format_header(v, out_len, etag, src->mtime, header, sizeof(header));
+    if (header_len < 0) {
+        LOG_ERROR("Response header too large: %s", filepath);
+        goto out;
+    }
+    entry = file_cache_insert_data(variants, filepath, header, header_len, out, out_len,
+                                   src->ino, src->mtime);
+    if (entry) {
+        entry->content_type = v->content_type;
+    }
+    LOG_INFO("Compressed %s: %zu -> %zd bytes", filepath, size, out_len);
 
-void http_send_status(int client_sock, int status_code) {
-    const char* response = get_status_message(status_code);
-    send(client_sock, response, strlen(response), 0);
-    LOG_INFO("Sent status %d response", status_code);
+out:
+    mem_free(buf);
+    mem_free(out);
+    return entry;
 }
 
-void http_get_response(int client_sock, const char* filepath) {
-    http_send_file(client_sock, filepath, false);
+// 动态 gzip 压缩：首次请求时压缩并缓存，原文件变化时随 inotify 事件失效，
+// 命中时再按 inode 和 mtime 校验后直接从缓存发送
+// 文件不存在、太小或太大时返回 false，由调用者按原文件处理
+static bool http_send_gzip(http_ctx_t* ctx, const char* filepath, const http_variant_t* v, bool head_only) {
+    FileCache* variants = ctx->cache->gzip;
+    if (!variants || g_config.gzip_level == 0) {
+        return false;
+    }
+
+    // pack 映像中的文件直接从映射的内存压缩
+    gzip_source_t src;
+    OpenFileEntry* file = NULL;
+    PackImage* pack = ctx->cache->pack;
+    const struct pack_entry* packed = pack ? pack_lookup(pack, filepath) : NULL;
+    if (packed) {
+        src = (gzip_source_t){pack_data(pack, packed->body_offset), NULL,
+                              packed->body_len, packed->ino, packed->mtime};
+    } else {
+        file = open_file_cache_get(ctx->cache->open_files, filepath);
+        if (!file) {
+            return false;
+        }
+        if (file->err || !S_ISREG(file->mode)) {
+            open_file_cache_release(file);
+            return false;
+        }
+        src = (gzip_source_t){NULL, file, file->size, file->ino, file->mtime};
+    }
+
+    // 压缩在事件循环中同步进行，大文件不压缩；缓存的变体依赖 inotify 失效，
+    // 无法监视文档根目录时只压缩 pack 映像中不会变化的文件
+    FileCacheEntry* entry = NULL;
+    if (src.size >= (size_t)g_config.gzip_min_length && src.size <= g_config.gzip_max_length &&
+        (packed || file_cache_fd(ctx->cache) >= 0) && file_cache_admits(variants, src.size)) {
+        entry = file_cache_lookup(variants, filepath);
+        if (entry && (entry->ino != src.ino || entry->mtime != src.mtime)) {
+            file_cache_release(entry);
+            entry = NULL;
+        }
+        if (!entry) {
+            entry = http_compress_file(variants, filepath, v, &src);
+        }
+    }
+    if (file) {
+        open_file_cache_release(file);
+    }
+
+    if (!entry) {
+        return false;
+    }
+    if (entry->header_len == 0) {
+        file_cache_release(entry);
+        return false;
+    }
+    http_send_entry(ctx, filepath, v, entry, head_only);
+    return true;
 }
 
-void http_head_response(int client_sock, const char* filepath) {
-    http_send_file(client_sock, filepath, true);
+// 发送文件；文本类资源优先发送客户端接受的预压缩文件 file.br / file.gz，
+// 没有预压缩文件时动态压缩
+static void http_send_file(http_ctx_t* ctx, const char* filepath, bool head_only) {
+    // 指纹路径按原文件发送，缓存、压缩变体和 pack 映像都以原文件路径为键
+    const char* target = fingerprint_resolve(ctx->cache->fingerprints, filepath);
+    if (target) {
+        filepath = target;
+        ctx->immutable = true;
+    }
+
+    // 已缓存的文件沿用插入时解析出的类型，只有未命中时才按扩展名解析
+    FileCacheEntry* cached = file_cache_lookup(ctx->cache, filepath);
+    http_variant_t variant = {cached ? cached->content_type : mime_lookup(filepath), NULL, false};
+
+    if (http_is_compressible(variant.content_type)) {
+        variant.vary = true;
+        const char* accept = ctx->request ? request_get_header(ctx->request, "Accept-Encoding") : NULL;
+        for (size_t i = 0; accept && i < http_sidecar_count; i++) {
+            if (!http_accepts_encoding(accept, http_sidecars[i].encoding)) {
+                continue;
+            }
+            char path[BUF_SIZE];
+            http_builder_t b;
+            http_builder_init(&b, path, sizeof(path));
+            http_builder_str(&b, filepath);
+            http_builder_str(&b, http_sidecars[i].suffix);
+            http_builder_terminate(&b);
+            if (b.overflow) {
+                continue;
+            }
+            variant.encoding = http_sidecars[i].encoding;
+            if (http_send_variant(ctx, path, &variant, head_only, true, true)) {
+                if (cached) {
+                    file_cache_release(cached);
+                }
+                return;
+            }
+        }
+
+        variant.encoding = "gzip";
+        if (accept && http_accepts_encoding(accept, "gzip") &&
+            http_send_gzip(ctx, filepath, &variant, head_only)) {
+            if (cached) {
+                file_cache_release(cached);
+            }
+            return;
+        }
+        variant.encoding = NULL;
+    }
+
+    if (cached) {
+        http_send_entry(ctx, filepath, &variant, cached, head_only);
+        return;
+    }
+    http_send_variant(ctx, filepath, &variant, head_only, false, false);
 }
 
-void http_post_response(int client_sock, const char* data, size_t length) {
-    char header[BUF_SIZE];
-    snprintf(header, BUF_SIZE,
-             "HTTP/1.1 200 OK\r\n"
-             "Content-Type: text/plain\r\n"
-             "Content-Length: %zu\r\n"
-             "Connection: close\r\n"
-             "\r\n",
-             length);
-
-    // 发送响应头
-    if (send(client_sock, header, strlen(header), 0) < 0) {
-        LOG_ERROR("Failed to send POST response header: %s", strerror(errno));
+
+void http_send_status(http_ctx_t* ctx, int status_code) {
+    // 请求无法解析或版本不支持时无法确定后续请求的边界，必须关闭连接
+    if (status_code == HTTP_STATUS_BAD_REQUEST ||
+        status_code == HTTP_STATUS_VERSION_NOT_SUPPORTED) {
+        ctx->keep_alive = false;
+    }
+
+    http_builder_t b;
+    bool ok = http_begin(ctx, &b, status_code);
+    if (ok) {
+        http_builder_literal(&b, "Content-Length: 0\r\n");
+        ok = http_commit(ctx, &b);
+    }
+    if (!ok) {
+        http_abort(ctx);
+        LOG_ERROR("Failed to queue status %d response", status_code);
         return;
     }
+    send_queue_end_response(ctx->out);
+    LOG_INFO("Queued status %d response", status_code);
+}
+
+void http_get_response(http_ctx_t* ctx, const char* filepath) {
+    http_send_file(ctx, filepath, false);
+}
 
-    LOG_INFO("Sent POST response, data length: %zu", length);
+void http_head_response(http_ctx_t* ctx, const char* filepath) {
+    http_send_file(ctx, filepath, true);
 }
 
+// POST 请求体的去向，未配置时为 -1，请求体原样回显
+static int post_sink_fd = -1;
+static const char* post_sink_path;
+// 下一个请求体的起始位置；每个请求体在 sink 中预留自己的区间，并发上传不会交错
+static off_t post_sink_end;
 
-const char* http_get_mime_type(const char* filename) {
-    const char* dot = strrchr(filename, '.');
-    if (!dot) {
-        return "application/octet-stream";
+int http_post_sink_open(const char* path) {
+    // splice 不能写入 O_APPEND 打开的文件；只有本进程写入，从原有内容之后开始分配
+    post_sink_fd = open(path, O_WRONLY | O_CREAT | O_CLOEXEC, 0644);
+    if (post_sink_fd < 0 || (post_sink_end = lseek(post_sink_fd, 0, SEEK_END)) < 0) {
+        LOG_ERROR("Cannot open POST sink %s: %s", path, strerror(errno));
+        http_post_sink_close();
+        return -1;
     }
+    post_sink_path = path;
+    return 0;
+}
+
+void http_post_sink_close(void) {
+    if (post_sink_fd >= 0) {
+        close(post_sink_fd);
+        post_sink_fd = -1;
+    }
+}
 
-    for (const struct mime_type* m = mime_types; m->extension; m++) {
-        if (strcasecmp(dot, m->extension) == 0) {
-            return m->type;
+// 缓冲区中的请求体不超过一个接收缓冲区，直接写入 sink 的 offset 处
+static bool http_sink_write(const char* data, size_t len, off_t offset) {
+    while (len > 0) {
+        ssize_t n = pwrite(post_sink_fd, data, len, offset);
+        if (n < 0 && errno == EINTR) {
+            continue;
         }
+        if (n < 0) {
+            LOG_ERROR("Failed to write POST sink %s: %s", post_sink_path, strerror(errno));
+            return false;
+        }
+        data += n;
+        offset += n;
+        len -= n;
     }
-    return "application/octet-stream";
-}
\ No newline at end of file
+    return true;
+}
+
+bool http_post_response(http_ctx_t* ctx, int sockfd, const char* body, size_t buffered, size_t length) {
+    // 写入 sink 时整个请求体使用从 offset 起预留的区间；客户端中途断开时该区间留下空洞
+    off_t offset = post_sink_end;
+
+    // 不在缓冲区中的部分从 socket 经管道直接转发，不经过用户态
+    SpliceStream* stream = NULL;
+    if (buffered < length) {
+        stream = splice_stream_create_body(post_sink_fd >= 0 ? post_sink_path : "(post echo)",
+                                           sockfd, length - buffered, post_sink_fd, offset + buffered);
+        if (!stream) {
+            LOG_ERROR("Failed to create POST body stream");
+            http_send_status(ctx, HTTP_STATUS_INTERNAL_ERROR);
+            return false;
+        }
+    }
+
+    http_builder_t b;
+    bool ok;
+    if (post_sink_fd >= 0) {
+        post_sink_end += length;
+        // 请求体全部写入 sink 后才回复，响应头在队列中排在请求体之后
+        if (buffered > 0 && !http_sink_write(body, buffered, offset)) {
+            splice_stream_destroy(stream);
+            http_send_status(ctx, HTTP_STATUS_INTERNAL_ERROR);
+            return false;
+        }
+        if (stream && !send_queue_append_stream(ctx->out, stream)) {
+            LOG_ERROR("Failed to queue POST body stream");
+            return false;
+        }
+        ok = http_begin(ctx, &b, HTTP_STATUS_NO_CONTENT) && http_commit(ctx, &b);
+    } else {
+        ok = http_begin(ctx, &b, HTTP_STATUS_OK);
+        if (ok) {
+            http_builder_literal(&b, "Content-Type: text/plain\r\nContent-Length: ");
+            http_builder_uint(&b, length);
+            http_builder_literal(&b, "\r\n");
+            ok = http_commit(ctx, &b) && send_queue_append(ctx->out, body, buffered);
+        }
+        if (!ok) {
+            splice_stream_destroy(stream);
+        } else if (stream && !send_queue_append_stream(ctx->out, stream)) {
+            LOG_ERROR("Failed to queue POST body stream");
+            return false;
+        }
+    }
+    if (!ok) {
+        LOG_ERROR("Failed to queue POST response");
+        return false;
+    }
+    send_queue_end_response(ctx->out);
+
+    LOG_INFO("Queued POST response, body length: %zu, buffered: %zu, %s",
+             length, buffered, post_sink_fd >= 0 ? "sink" : "echo");
+    return true;
+}
@@ -1,28 +1,45 @@
 #ifndef HTTP_RESPONSE_H
 #define HTTP_RESPONSE_H
 
+#include "send_queue.h"
+#include "file_cache.h"
+#include "parse.h"
+#include "http_header.h"
 #include <stdlib.h>
 #include <stdbool.h>
 
 // HTTP 响应状态码
 #define HTTP_STATUS_OK                200
+#define HTTP_STATUS_NO_CONTENT        204
+#define HTTP_STATUS_PARTIAL_CONTENT   206
+#define HTTP_STATUS_NOT_MODIFIED      304
 #define HTTP_STATUS_BAD_REQUEST       400
 #define HTTP_STATUS_NOT_FOUND         404
+#define HTTP_STATUS_CONTENT_TOO_LARGE 413
+#define HTTP_STATUS_RANGE_NOT_SATISFIABLE 416
 #define HTTP_STATUS_INTERNAL_ERROR    500
 #define HTTP_STATUS_NOT_IMPLEMENTED   501
 #define HTTP_STATUS_VERSION_NOT_SUPPORTED 505
 
-// MIME 类型结构体
-struct mime_type {
-    const char *extension;
-    const char *type;
-};
+// 单个请求的响应上下文
+typedef struct {
+    SendQueue* out;             // 连接的发送队列
+    FileCache* cache;           // 文档根目录的文件缓存
+    const Request* request;     // 解析后的请求，解析失败时为 NULL
+    bool keep_alive;            // 响应后是否保持连接，发送错误状态时可能被改为 false
+    bool immutable;             // 请求的是带内容哈希的指纹路径，响应可以永久缓存
+} http_ctx_t;
 
-// 响应处理函数
-void http_send_status(int client_sock, int status_code);
-void http_get_response(int client_sock, const char* filepath);
-void http_head_response(int client_sock, const char* filepath);
-void http_post_response(int client_sock, const char* data, size_t length);
-const char* http_get_mime_type(const char* filename);
+// 响应处理函数，响应写入连接的发送队列，由调用者统一发送
+void http_send_status(http_ctx_t* ctx, int status_code);
+void http_get_response(http_ctx_t* ctx, const char* filepath);
+void http_head_response(http_ctx_t* ctx, const char* filepath);
+// POST 请求体共 length 字节，开头 buffered 字节已在接收缓冲区的 body 中，其余仍在 sockfd 中，
+// 由发送队列经 splice 转发；返回 false 时请求体未能完整消费，调用者应关闭连接
+bool http_post_response(http_ctx_t* ctx, int sockfd, const char* body, size_t buffered, size_t length);
+
+// 打开后 POST 请求体追加写入 path，回复 204；未打开时原样回显请求体
+int http_post_sink_open(const char* path);
+void http_post_sink_close(void);
 
 #endif
\ No newline at end of file
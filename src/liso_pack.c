@@ -0,0 +1,244 @@
+/*
+ * liso_pack: 将文档根目录打包为一个文件，供服务器通过 --pack 映射后直接发送
+ *
+ * 布局：pack_header | 按路径排序的 pack_entry 索引 | 路径和预渲染的响应头 | 按页对齐的文件内容
+ *
+ * 用法：liso_pack <docroot> <output>
+ */
+
+#include "pack.h"
+#include "http_header.h"
+#include "mime.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+#define PATH_MAX_LEN 4096
+
+// 待打包的文件
+struct pack_file {
+    char *rel;                  // 相对于文档根目录的路径
+    struct stat st;
+    char header[1024];
+    int header_len;
+};
+
+static struct pack_file *files;
+static size_t file_count;
+static size_t file_capacity;
+
+static int add_file(const char *rel, const struct stat *st) {
+    if (file_count == file_capacity) {
+        size_t capacity = file_capacity ? file_capacity * 2 : 64;
+        struct pack_file *grown = realloc(files, capacity * sizeof(*files));
+        if (!grown) {
+            return -1;
+        }
+        files = grown;
+        file_capacity = capacity;
+    }
+
+    struct pack_file *f = &files[file_count];
+    f->rel = strdup(rel);
+    if (!f->rel) {
+        return -1;
+    }
+    f->st = *st;
+    file_count++;
+    return 0;
+}
+
+// 递归收集目录下的普通文件
+static int collect(const char *root, const char *rel) {
+    char dir_path[PATH_MAX_LEN];
+    snprintf(dir_path, sizeof(dir_path), "%s%s%s", root, *rel ? "/" : "", rel);
+
+    DIR *dir = opendir(dir_path);
+    if (!dir) {
+        fprintf(stderr, "Cannot open %s: %s\n", dir_path, strerror(errno));
+        return -1;
+    }
+
+    struct dirent *de;
+    int ret = 0;
+    while (ret == 0 && (de = readdir(dir))) {
+        if (strcmp(de->d_name, ".") == 0 || strcmp(de->d_name, "..") == 0) {
+            continue;
+        }
+
+        char child_rel[PATH_MAX_LEN];
+        char child_path[PATH_MAX_LEN];
+        if (snprintf(child_rel, sizeof(child_rel), "%s%s%s", rel, *rel ? "/" : "", de->d_name) >= (int)sizeof(child_rel) ||
+            snprintf(child_path, sizeof(child_path), "%s/%s", root, child_rel) >= (int)sizeof(child_path)) {
+            fprintf(stderr, "Path too long: %s/%s\n", dir_path, de->d_name);
+            ret = -1;
+            break;
+        }
+
+        struct stat st;
+        if (stat(child_path, &st) < 0) {
+            fprintf(stderr, "Cannot stat %s: %s\n", child_path, strerror(errno));
+            ret = -1;
+        } else if (S_ISDIR(st.st_mode)) {
+            ret = collect(root, child_rel);
+        } else if (S_ISREG(st.st_mode)) {
+            ret = add_file(child_rel, &st);
+        }
+    }
+    closedir(dir);
+    return ret;
+}
+
+static int compare_files(const void *a, const void *b) {
+    return strcmp(((const struct pack_file *)a)->rel, ((const struct pack_file *)b)->rel);
+}
+
+static int write_all(int fd, const void *data, size_t len, off_t offset) {
+    const char *p = data;
+    while (len > 0) {
+        ssize_t n = pwrite(fd, p, len, offset);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        p += n;
+        len -= n;
+        offset += n;
+    }
+    return 0;
+}
+
+// 将源文件内容复制到 pack 的 offset 处
+static int copy_body(int out, const char *path, size_t len, off_t offset) {
+    int in = open(path, O_RDONLY);
+    if (in < 0) {
+        return -1;
+    }
+
+    char buf[65536];
+    size_t done = 0;
+    while (done < len) {
+        ssize_t n = read(in, buf, sizeof(buf) < len - done ? sizeof(buf) : len - done);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0 || write_all(out, buf, n, offset + done) != 0) {
+            close(in);
+            return -1;
+        }
+        done += n;
+    }
+    close(in);
+    return 0;
+}
+
+static uint64_t align_up(uint64_t value, uint64_t align) {
+    return (value + align - 1) / align * align;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc != 3 && argc != 4) {
+        fprintf(stderr, "usage: %s <docroot> <output> [mime.types]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    const char *root = argv[1];
+    const char *output = argv[2];
+
+    // 与服务器使用同一份映射，响应头中的 Content-Type 才会一致
+    if (mime_init(argc == 4 ? argv[3] : MIME_TYPES_DEFAULT) != 0) {
+        return EXIT_FAILURE;
+    }
+
+    if (collect(root, "") != 0) {
+        return EXIT_FAILURE;
+    }
+    qsort(files, file_count, sizeof(*files), compare_files);
+
+    struct pack_entry *index = calloc(file_count ? file_count : 1, sizeof(*index));
+    if (!index) {
+        fprintf(stderr, "Out of memory\n");
+        return EXIT_FAILURE;
+    }
+
+    // 计算布局：路径和响应头紧随索引，文件内容从下一页开始逐个对齐
+    uint64_t offset = sizeof(struct pack_header);
+    uint64_t index_offset = align_up(offset, __alignof__(struct pack_entry));
+    offset = index_offset + file_count * sizeof(struct pack_entry);
+    for (size_t i = 0; i < file_count; i++) {
+        struct pack_file *f = &files[i];
+        http_variant_t variant;
+        char etag[ETAG_MAX];
+        http_variant_for_file(f->rel, &variant);
+        http_format_etag(f->st.st_ino, f->st.st_size, f->st.st_mtime, etag, sizeof(etag));
+        f->header_len = http_format_header(&variant, f->st.st_size, etag, f->st.st_mtime,
+                                           f->header, sizeof(f->header));
+        if (f->header_len < 0) {
+            fprintf(stderr, "Response header too large: %s\n", f->rel);
+            return EXIT_FAILURE;
+        }
+
+        index[i].path_offset = offset;
+        index[i].path_len = strlen(f->rel);
+        offset += index[i].path_len;
+        index[i].header_offset = offset;
+        index[i].header_len = f->header_len;
+        offset += f->header_len;
+    }
+    for (size_t i = 0; i < file_count; i++) {
+        offset = align_up(offset, PACK_ALIGN);
+        index[i].body_offset = offset;
+        index[i].body_len = files[i].st.st_size;
+        index[i].ino = files[i].st.st_ino;
+        index[i].mtime = files[i].st.st_mtime;
+        offset += index[i].body_len;
+    }
+
+    struct pack_header header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, PACK_MAGIC, sizeof(header.magic));
+    header.version = PACK_VERSION;
+    header.count = file_count;
+    header.index_offset = index_offset;
+    header.size = offset;
+
+    // 先写临时文件，完成后原子替换，正在运行的服务器映射的旧文件不受影响
+    char tmp_path[PATH_MAX_LEN];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", output);
+    int out = open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (out < 0) {
+        fprintf(stderr, "Cannot create %s: %s\n", tmp_path, strerror(errno));
+        return EXIT_FAILURE;
+    }
+
+    int ret = write_all(out, &header, sizeof(header), 0) ||
+              write_all(out, index, file_count * sizeof(*index), index_offset);
+    for (size_t i = 0; ret == 0 && i < file_count; i++) {
+        char path[PATH_MAX_LEN];
+        snprintf(path, sizeof(path), "%s/%s", root, files[i].rel);
+        ret = write_all(out, files[i].rel, index[i].path_len, index[i].path_offset) ||
+              write_all(out, files[i].header, index[i].header_len, index[i].header_offset) ||
+              copy_body(out, path, index[i].body_len, index[i].body_offset);
+        if (ret != 0) {
+            fprintf(stderr, "Failed to pack %s: %s\n", path, strerror(errno));
+        }
+    }
+    if (ret == 0 && ftruncate(out, offset) != 0) {
+        ret = -1;
+    }
+    if (close(out) != 0 || ret != 0 || rename(tmp_path, output) != 0) {
+        fprintf(stderr, "Failed to write %s\n", output);
+        unlink(tmp_path);
+        return EXIT_FAILURE;
+    }
+
+    printf("Packed %zu files from %s into %s (%llu bytes)\n",
+           file_count, root, output, (unsigned long long)offset);
+    return EXIT_SUCCESS;
+}
@@ -1,8 +1,15 @@
 #include "logger.h"
+#include "mem_stats.h"
+#include <stdint.h>
+#include <stdlib.h>
 #include <string.h>
+#include <stdatomic.h>
 #include <sys/time.h>
 #include <pthread.h>
 
+#define LOG_MSG_MAX 1000                        // 异步记录正文的最大长度，超出部分截断
+#define LOG_FILE_BUFFER (64 * 1024)             // 异步模式下日志文件的 stdio 缓冲区，按批写出
+
 static FILE* log_file = NULL;
 static pthread_mutex_t log_mutex = PTHREAD_MUTEX_INITIALIZER;
 
@@ -13,6 +20,39 @@ static const char* level_names[] = {
     "ERROR"
 };
 
+// 环形缓冲区的槽位，seq 等于写入位置时可写，等于写入位置 + 1 时可读
+typedef struct {
+    atomic_size_t seq;
+    time_t time;
+    log_level_t level;
+    const char* file;       // __FILE__，静态字符串，只保存指针
+    int line;
+    char msg[LOG_MSG_MAX];
+} log_record_t;
+
+// 多生产者单消费者的有界队列：生产者以 CAS 竞争写入位置，后台线程按序读取。
+// 读写槽位不加锁；只有后台线程空闲或生产者等待空位时，才通过 lock 和条件变量互相唤醒
+static struct {
+    log_record_t* records;
+    size_t mask;
+    log_overflow_t overflow;
+    atomic_size_t tail;     // 下一个写入位置，由生产者竞争
+    size_t head;            // 下一个读取位置，只由后台线程访问
+    atomic_bool stopping;
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t nonempty;    // 后台线程在缓冲区为空时等待
+    pthread_cond_t space;       // 策略为等待时，生产者在缓冲区满时等待
+    atomic_bool sleeping;       // 后台线程正在或即将等待 nonempty
+    atomic_size_t blocked;      // 正在等待 space 的生产者数
+
+    // 统计
+    atomic_size_t written;
+    atomic_size_t dropped;
+} ring;
+
+static bool async_mode = false;
+
 int log_init(const char* log_file_path) {
     log_file = fopen(log_file_path, "a");
     if (log_file == NULL) {
@@ -21,50 +61,262 @@ int log_init(const char* log_file_path) {
     return 0;
 }
 
+// 格式化一行日志，时间字符串按秒缓存，只由持有 log_mutex 的线程或后台线程调用
+static void format_line(char* out, size_t size, time_t t, log_level_t level,
+                        const char* file, int line, const char* content) {
+    static time_t cached_time = -1;
+    static char time_str[32];
+    if (t != cached_time) {
+        struct tm local_time;
+        localtime_r(&t, &local_time);
+        strftime(time_str, sizeof(time_str), "%Y-%m-%d %H:%M:%S", &local_time);
+        cached_time = t;
+    }
+
+    snprintf(out, size, "[%s][%s][%s:%d] %s\n",
+             time_str, level_names[level], file, line, content);
+}
+
+// 写入文件并输出到控制台，ERROR 级别使用 stderr，其他级别使用 stdout
+static void output_line(log_level_t level, const char* log_msg) {
+    fputs(log_msg, log_file);
+    fputs(log_msg, level == LOG_ERROR ? stderr : stdout);
+}
+
+// 取出所有已提交的记录写出，返回处理的条数
+static size_t ring_drain(void) {
+    char log_msg[LOG_MSG_MAX + 512];
+    size_t count = 0;
+
+    for (;;) {
+        log_record_t* r = &ring.records[ring.head & ring.mask];
+        if (atomic_load_explicit(&r->seq, memory_order_acquire) != ring.head + 1) {
+            break;
+        }
+        // 交还槽位前把记录的内容全部复制出来，之后生产者可能立即覆盖它
+        log_level_t level = r->level;
+        format_line(log_msg, sizeof(log_msg), r->time, level, r->file, r->line, r->msg);
+        // 槽位在下一轮写入位置处重新可写
+        atomic_store_explicit(&r->seq, ring.head + ring.mask + 1, memory_order_release);
+        ring.head++;
+
+        output_line(level, log_msg);
+        count++;
+    }
+
+    if (count > 0) {
+        // 先唤醒等待空位的生产者，再做耗时的写出
+        atomic_thread_fence(memory_order_seq_cst);
+        if (atomic_load(&ring.blocked) > 0) {
+            pthread_mutex_lock(&ring.lock);
+            pthread_cond_broadcast(&ring.space);
+            pthread_mutex_unlock(&ring.lock);
+        }
+        fflush(log_file);
+        fflush(stdout);
+        fflush(stderr);
+        atomic_fetch_add_explicit(&ring.written, count, memory_order_relaxed);
+    }
+    return count;
+}
+
+// 下一个待读取的记录是否已提交
+static bool ring_ready(void) {
+    const log_record_t* r = &ring.records[ring.head & ring.mask];
+    return atomic_load_explicit(&r->seq, memory_order_acquire) == ring.head + 1;
+}
+
+// 后台线程：缓冲区为空时等待生产者唤醒，醒来后把其间到达的记录一次写出
+static void* log_flush_main(void* arg) {
+    (void)arg;
+
+    for (;;) {
+        // 先读停止标志再取记录，停止前提交的记录都会写出
+        bool stopping = atomic_load(&ring.stopping);
+        if (ring_drain() > 0) {
+            continue;
+        }
+        if (stopping) {
+            break;
+        }
+
+        // 先声明将要等待再检查缓冲区，与生产者的“先提交再检查 sleeping”配对，不会漏掉唤醒
+        pthread_mutex_lock(&ring.lock);
+        atomic_store(&ring.sleeping, true);
+        atomic_thread_fence(memory_order_seq_cst);
+        if (!ring_ready() && !atomic_load(&ring.stopping)) {
+            pthread_cond_wait(&ring.nonempty, &ring.lock);
+        }
+        atomic_store(&ring.sleeping, false);
+        pthread_mutex_unlock(&ring.lock);
+    }
+    return NULL;
+}
+
+int log_start_async(size_t records, log_overflow_t overflow) {
+    if (log_file == NULL || async_mode) {
+        return -1;
+    }
+
+    size_t capacity = 1;
+    while (capacity < records) {
+        capacity <<= 1;
+    }
+    ring.records = mem_malloc(MEM_TAG_LOGGER, capacity * sizeof(log_record_t));
+    if (!ring.records) {
+        LOG_ERROR("Failed to allocate log buffer of %zu records", capacity);
+        return -1;
+    }
+    for (size_t i = 0; i < capacity; i++) {
+        atomic_init(&ring.records[i].seq, i);
+    }
+    ring.mask = capacity - 1;
+    ring.overflow = overflow;
+    ring.head = 0;
+    atomic_init(&ring.tail, 0);
+    atomic_init(&ring.stopping, false);
+    atomic_init(&ring.sleeping, false);
+    atomic_init(&ring.blocked, 0);
+    atomic_init(&ring.written, 0);
+    atomic_init(&ring.dropped, 0);
+    pthread_mutex_init(&ring.lock, NULL);
+    pthread_cond_init(&ring.nonempty, NULL);
+    pthread_cond_init(&ring.space, NULL);
+    setvbuf(log_file, NULL, _IOFBF, LOG_FILE_BUFFER);
+
+    int err = pthread_create(&ring.thread, NULL, log_flush_main, NULL);
+    if (err != 0) {
+        LOG_ERROR("Failed to start log thread: %s", strerror(err));
+        pthread_cond_destroy(&ring.space);
+        pthread_cond_destroy(&ring.nonempty);
+        pthread_mutex_destroy(&ring.lock);
+        mem_free(ring.records);
+        ring.records = NULL;
+        return -1;
+    }
+    async_mode = true;
+    return 0;
+}
+
+// 占用一个槽位，缓冲区满且策略为丢弃时返回 NULL
+static log_record_t* ring_claim(size_t* pos_out) {
+    size_t pos = atomic_load_explicit(&ring.tail, memory_order_relaxed);
+    for (;;) {
+        log_record_t* r = &ring.records[pos & ring.mask];
+        size_t seq = atomic_load_explicit(&r->seq, memory_order_acquire);
+        intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+        if (diff == 0) {
+            if (atomic_compare_exchange_weak_explicit(&ring.tail, &pos, pos + 1,
+                                                      memory_order_relaxed, memory_order_relaxed)) {
+                *pos_out = pos;
+                return r;
+            }
+        } else if (diff < 0) {
+            // 槽位仍是上一轮的记录，缓冲区已满
+            if (ring.overflow == LOG_OVERFLOW_DROP) {
+                atomic_fetch_add_explicit(&ring.dropped, 1, memory_order_relaxed);
+                return NULL;
+            }
+            // 登记后再检查该槽位，后台线程交还槽位后检查 blocked，不会漏掉唤醒
+            pthread_mutex_lock(&ring.lock);
+            atomic_fetch_add(&ring.blocked, 1);
+            atomic_thread_fence(memory_order_seq_cst);
+            if ((intptr_t)atomic_load_explicit(&r->seq, memory_order_acquire) - (intptr_t)pos < 0) {
+                pthread_cond_wait(&ring.space, &ring.lock);
+            }
+            atomic_fetch_sub(&ring.blocked, 1);
+            pthread_mutex_unlock(&ring.lock);
+            pos = atomic_load_explicit(&ring.tail, memory_order_relaxed);
+        } else {
+            // 其他生产者已占用该位置
+            pos = atomic_load_explicit(&ring.tail, memory_order_relaxed);
+        }
+    }
+}
+
 void log_write(log_level_t level, const char* file, int line, const char* fmt, ...) {
     if (log_file == NULL) return;
 
-    time_t now;
-    time(&now);
-    struct tm* local_time = localtime(&now);
-    
-    char time_str[32];
-    strftime(time_str, sizeof(time_str), "%Y-%m-%d %H:%M:%S", local_time);
+    va_list args;
+    if (async_mode) {
+        // 只复制记录，格式化时间和写出由后台线程完成
+        size_t pos;
+        log_record_t* r = ring_claim(&pos);
+        if (!r) {
+            return;
+        }
+        r->time = time(NULL);
+        r->level = level;
+        r->file = file;
+        r->line = line;
+        va_start(args, fmt);
+        vsnprintf(r->msg, sizeof(r->msg), fmt, args);
+        va_end(args);
+        atomic_store_explicit(&r->seq, pos + 1, memory_order_release);
+
+        // 后台线程空闲时唤醒它；忙于写出时不加锁，它会在下一轮取到这条记录
+        atomic_thread_fence(memory_order_seq_cst);
+        if (atomic_load(&ring.sleeping)) {
+            pthread_mutex_lock(&ring.lock);
+            pthread_cond_signal(&ring.nonempty);
+            pthread_mutex_unlock(&ring.lock);
+        }
+        return;
+    }
 
     // 准备日志消息
     char log_msg[4096];
     char content[2048];
-    
-    va_list args;
+
     va_start(args, fmt);
     vsnprintf(content, sizeof(content), fmt, args);
     va_end(args);
 
-    snprintf(log_msg, sizeof(log_msg), "[%s][%s][%s:%d] %s\n",
-             time_str, level_names[level], file, line, content);
-
     pthread_mutex_lock(&log_mutex);
-    
-    // 写入文件
-    fputs(log_msg, log_file);
+
+    format_line(log_msg, sizeof(log_msg), time(NULL), level, file, line, content);
+    output_line(level, log_msg);
     fflush(log_file);
-    
-    // 同时输出到控制台
-    // ERROR 级别使用 stderr，其他级别使用 stdout
-    if (level == LOG_ERROR) {
-        fputs(log_msg, stderr);
-        fflush(stderr);
-    } else {
-        fputs(log_msg, stdout);
-        fflush(stdout);
-    }
-    
+    fflush(level == LOG_ERROR ? stderr : stdout);
+
     pthread_mutex_unlock(&log_mutex);
 }
 
+void log_dump_stats(void) {
+    if (!async_mode) {
+        LOG_INFO("Logger: synchronous");
+        return;
+    }
+
+    LOG_INFO("Logger: async, buffer: %zu records, %s when full, written: %zu, dropped: %zu",
+             ring.mask + 1,
+             ring.overflow == LOG_OVERFLOW_DROP ? "drop" : "block",
+             atomic_load_explicit(&ring.written, memory_order_relaxed),
+             atomic_load_explicit(&ring.dropped, memory_order_relaxed));
+}
+
 void log_close(void) {
+    if (async_mode) {
+        pthread_mutex_lock(&ring.lock);
+        atomic_store(&ring.stopping, true);
+        pthread_cond_signal(&ring.nonempty);
+        pthread_mutex_unlock(&ring.lock);
+        pthread_join(ring.thread, NULL);
+        async_mode = false;
+        pthread_cond_destroy(&ring.space);
+        pthread_cond_destroy(&ring.nonempty);
+        pthread_mutex_destroy(&ring.lock);
+        mem_free(ring.records);
+        ring.records = NULL;
+
+        size_t dropped = atomic_load(&ring.dropped);
+        if (dropped > 0) {
+            LOG_WARN("Logger dropped %zu records because the buffer was full", dropped);
+        }
+    }
+
     if (log_file != NULL) {
         fclose(log_file);
         log_file = NULL;
     }
-} 
\ No newline at end of file
+}
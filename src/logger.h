@@ -2,6 +2,8 @@
 #define LOGGER_H
 
 #include <stdio.h>
+#include <stdbool.h>
+#include <stddef.h>
 #include <time.h>
 #include <stdarg.h>
 
@@ -13,13 +15,26 @@ typedef enum {
     LOG_ERROR
 } log_level_t;
 
+// 异步模式下环形缓冲区已满时的处理方式
+typedef enum {
+    LOG_OVERFLOW_DROP,      // 丢弃该条日志并计数，不会阻塞事件循环
+    LOG_OVERFLOW_BLOCK      // 等待后台线程腾出空位
+} log_overflow_t;
+
 // 日志初始化函数
 int log_init(const char* log_file_path);
 
+// 切换到异步模式：调用者只把记录复制进 records 个槽位的无锁环形缓冲区，
+// 由后台线程格式化并批量写出；records 向上取整为 2 的幂
+int log_start_async(size_t records, log_overflow_t overflow);
+
 // 日志写入函数
 void log_write(log_level_t level, const char* file, int line, const char* fmt, ...);
 
-// 日志关闭函数
+// 输出异步模式的记录数和丢弃数
+void log_dump_stats(void);
+
+// 日志关闭函数，异步模式下先写出缓冲区中剩余的记录
 void log_close(void);
 
 // 日志宏定义，方便使用
@@ -0,0 +1,151 @@
+#include "mem_stats.h"
+#include "logger.h"
+#include <string.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// 每个分配块前的头部，记录标签和用户请求的大小
+// 使用 union 保证用户指针按 max_align_t 对齐
+typedef union {
+    struct {
+        size_t size;
+        mem_tag_t tag;
+    } info;
+    max_align_t align;
+} mem_header_t;
+
+typedef struct {
+    size_t live_bytes;
+    size_t live_allocs;
+    size_t peak_bytes;
+    size_t total_allocs;
+} mem_counter_t;
+
+static mem_counter_t counters[MEM_TAG_COUNT];
+
+static const char* tag_names[MEM_TAG_COUNT] = {
+    "conn_buffer",
+    "conn_table",
+    "request",
+    "response",
+    "file_cache",
+    "open_files",
+    "compress",
+    "mime",
+    "fingerprint",
+    "logger",
+    "prefetch"
+};
+
+// 计数器使用 relaxed 原子操作，开销很小且允许其他线程分配
+static void account_alloc(mem_tag_t tag, size_t size) {
+    mem_counter_t* c = &counters[tag];
+    size_t live = __atomic_add_fetch(&c->live_bytes, size, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&c->live_allocs, 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&c->total_allocs, 1, __ATOMIC_RELAXED);
+
+    size_t peak = __atomic_load_n(&c->peak_bytes, __ATOMIC_RELAXED);
+    while (live > peak &&
+           !__atomic_compare_exchange_n(&c->peak_bytes, &peak, live, 1,
+                                        __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    }
+}
+
+static void account_free(mem_tag_t tag, size_t size) {
+    mem_counter_t* c = &counters[tag];
+    __atomic_sub_fetch(&c->live_bytes, size, __ATOMIC_RELAXED);
+    __atomic_sub_fetch(&c->live_allocs, 1, __ATOMIC_RELAXED);
+}
+
+void* mem_malloc(mem_tag_t tag, size_t size) {
+    if (size > SIZE_MAX - sizeof(mem_header_t)) {
+        return NULL;
+    }
+
+    mem_header_t* header = malloc(sizeof(mem_header_t) + size);
+    if (!header) {
+        return NULL;
+    }
+
+    header->info.size = size;
+    header->info.tag = tag;
+    account_alloc(tag, size);
+    return header + 1;
+}
+
+void* mem_calloc(mem_tag_t tag, size_t count, size_t size) {
+    if (size != 0 && count > SIZE_MAX / size) {
+        return NULL;
+    }
+
+    void* ptr = mem_malloc(tag, count * size);
+    if (ptr) {
+        memset(ptr, 0, count * size);
+    }
+    return ptr;
+}
+
+void* mem_realloc(mem_tag_t tag, void* ptr, size_t size) {
+    if (!ptr) {
+        return mem_malloc(tag, size);
+    }
+    if (size > SIZE_MAX - sizeof(mem_header_t)) {
+        return NULL;
+    }
+
+    mem_header_t* old_header = (mem_header_t*)ptr - 1;
+    mem_tag_t old_tag = old_header->info.tag;
+    size_t old_size = old_header->info.size;
+
+    mem_header_t* header = realloc(old_header, sizeof(mem_header_t) + size);
+    if (!header) {
+        // 原内存块保持不变
+        return NULL;
+    }
+
+    account_free(old_tag, old_size);
+    header->info.size = size;
+    header->info.tag = tag;
+    account_alloc(tag, size);
+    return header + 1;
+}
+
+void mem_free(void* ptr) {
+    if (!ptr) {
+        return;
+    }
+
+    mem_header_t* header = (mem_header_t*)ptr - 1;
+    account_free(header->info.tag, header->info.size);
+    free(header);
+}
+
+void mem_stats_get(mem_tag_t tag, mem_tag_stats_t* out) {
+    const mem_counter_t* c = &counters[tag];
+    out->live_bytes = __atomic_load_n(&c->live_bytes, __ATOMIC_RELAXED);
+    out->live_allocs = __atomic_load_n(&c->live_allocs, __ATOMIC_RELAXED);
+    out->peak_bytes = __atomic_load_n(&c->peak_bytes, __ATOMIC_RELAXED);
+    out->total_allocs = __atomic_load_n(&c->total_allocs, __ATOMIC_RELAXED);
+}
+
+const char* mem_tag_name(mem_tag_t tag) {
+    return tag < MEM_TAG_COUNT ? tag_names[tag] : "unknown";
+}
+
+void mem_stats_dump(void) {
+    size_t total_live = 0;
+
+    for (int i = 0; i < MEM_TAG_COUNT; i++) {
+        mem_tag_stats_t stats;
+        mem_stats_get((mem_tag_t)i, &stats);
+        total_live += stats.live_bytes;
+        LOG_INFO("Memory [%s] live: %zu bytes in %zu allocs, peak: %zu bytes, total allocs: %zu",
+                 tag_names[i],
+                 stats.live_bytes,
+                 stats.live_allocs,
+                 stats.peak_bytes,
+                 stats.total_allocs);
+    }
+
+    LOG_INFO("Memory total live: %zu bytes", total_live);
+}
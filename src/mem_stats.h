@@ -0,0 +1,43 @@
+#ifndef MEM_STATS_H
+#define MEM_STATS_H
+
+#include <stdlib.h>
+
+// 内存分配标签，每个标签对应一个组件
+typedef enum {
+    MEM_TAG_CONN_BUFFER,    // 连接接收缓冲区
+    MEM_TAG_CONN_TABLE,     // 连接表
+    MEM_TAG_REQUEST,        // 解析后的请求及请求头
+    MEM_TAG_RESPONSE,       // 响应构建
+    MEM_TAG_FILE_CACHE,     // 静态文件缓存
+    MEM_TAG_OPEN_FILES,     // 打开文件缓存
+    MEM_TAG_COMPRESS,       // 动态压缩的临时缓冲区及 zlib 状态
+    MEM_TAG_MIME,           // MIME 类型映射及完美哈希表
+    MEM_TAG_FINGERPRINT,    // 内容指纹路径索引
+    MEM_TAG_LOGGER,         // 异步日志环形缓冲区
+    MEM_TAG_PREFETCH,       // 后台预读的任务及读缓冲区
+    MEM_TAG_COUNT
+} mem_tag_t;
+
+// 单个标签的统计快照
+typedef struct {
+    size_t live_bytes;      // 当前占用字节数
+    size_t live_allocs;     // 当前未释放的分配次数
+    size_t peak_bytes;      // 历史峰值字节数
+    size_t total_allocs;    // 累计分配次数
+} mem_tag_stats_t;
+
+// 带标签的分配函数，必须与 mem_free 配对使用
+void* mem_malloc(mem_tag_t tag, size_t size);
+void* mem_calloc(mem_tag_t tag, size_t count, size_t size);
+void* mem_realloc(mem_tag_t tag, void* ptr, size_t size);
+void mem_free(void* ptr);
+
+// 读取统计信息
+void mem_stats_get(mem_tag_t tag, mem_tag_stats_t* out);
+const char* mem_tag_name(mem_tag_t tag);
+
+// 将所有标签的统计输出到日志
+void mem_stats_dump(void);
+
+#endif
@@ -0,0 +1,349 @@
+#include "mime.h"
+#include "mem_stats.h"
+#include "logger.h"
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <ctype.h>
+#include <stdbool.h>
+
+#define MIME_DISPLACE_MAX (1u << 16) // 单个桶尝试的位移上限，超过后扩大槽数组重建
+#define MIME_SLOT_FACTOR_MAX 4       // 槽数组最多扩大到映射数的倍数，仍失败时放弃构建
+
+// 内置映射，映射文件缺失或缺少对应扩展名时使用
+static const char builtin_types[] =
+    "text/html                  html htm\n"
+    "text/css                   css\n"
+    "text/plain                 txt\n"
+    "text/markdown              md\n"
+    "text/csv                   csv\n"
+    "application/javascript     js mjs\n"
+    "application/json           json map\n"
+    "application/xml            xml\n"
+    "application/wasm           wasm\n"
+    "application/pdf            pdf\n"
+    "application/zip            zip\n"
+    "application/gzip           gz\n"
+    "image/jpeg                 jpg jpeg\n"
+    "image/png                  png\n"
+    "image/gif                  gif\n"
+    "image/webp                 webp\n"
+    "image/avif                 avif\n"
+    "image/svg+xml              svg\n"
+    "image/x-icon               ico\n"
+    "font/woff                  woff\n"
+    "font/woff2                 woff2\n"
+    "font/ttf                   ttf\n"
+    "font/otf                   otf\n"
+    "audio/mpeg                 mp3\n"
+    "video/mp4                  mp4\n"
+    "video/webm                 webm\n";
+
+// 扩展名到类型的映射，ext 已转为小写
+typedef struct {
+    const char *ext;
+    const char *type;
+} mime_entry_t;
+
+// 加载期间收集的映射，指向 texts 中就地切分的字符串
+static char *texts[2];
+static mime_entry_t *entries;
+static size_t entry_count;
+static size_t entry_capacity;
+
+// 完美哈希：扩展名先按 hash(ext, 0) 分桶，桶内按 hash(ext, displacements[b]) 落到互不冲突的槽
+static mime_entry_t *slots;
+static size_t slot_count;
+static uint32_t *displacements;
+static size_t bucket_count;
+
+// 带种子的 FNV-1a，最后用 murmur3 的 fmix32 打散低位
+static uint32_t mime_hash(const char *key, size_t len, uint32_t seed) {
+    uint32_t h = 2166136261u ^ seed;
+    for (size_t i = 0; i < len; i++) {
+        h ^= (unsigned char)key[i];
+        h *= 16777619u;
+    }
+    h ^= h >> 16;
+    h *= 0x85ebca6bu;
+    h ^= h >> 13;
+    h *= 0xc2b2ae35u;
+    h ^= h >> 16;
+    return h;
+}
+
+static int add_entry(const char *ext, const char *type) {
+    if (entry_count == entry_capacity) {
+        size_t capacity = entry_capacity ? entry_capacity * 2 : 256;
+        mime_entry_t *grown = mem_realloc(MEM_TAG_MIME, entries, capacity * sizeof(*entries));
+        if (!grown) {
+            return -1;
+        }
+        entries = grown;
+        entry_capacity = capacity;
+    }
+    entries[entry_count].ext = ext;
+    entries[entry_count].type = type;
+    entry_count++;
+    return 0;
+}
+
+// 就地解析 mime.types 格式：每行一个类型，后跟若干扩展名，# 开头为注释
+static int parse_types(char *text) {
+    char *line_save;
+    for (char *line = strtok_r(text, "\n", &line_save); line; line = strtok_r(NULL, "\n", &line_save)) {
+        char *hash = strchr(line, '#');
+        if (hash) {
+            *hash = '\0';
+        }
+
+        char *save;
+        const char *type = strtok_r(line, " \t\r", &save);
+        if (!type) {
+            continue;
+        }
+        for (char *ext = strtok_r(NULL, " \t\r", &save); ext; ext = strtok_r(NULL, " \t\r", &save)) {
+            // 只按最后一个扩展名查找，带点或过长的扩展名永远不会命中
+            size_t len = strlen(ext);
+            if (len >= MIME_EXT_MAX || strchr(ext, '.')) {
+                continue;
+            }
+            for (char *p = ext; *p; p++) {
+                *p = tolower((unsigned char)*p);
+            }
+            if (add_entry(ext, type) != 0) {
+                return -1;
+            }
+        }
+    }
+    return 0;
+}
+
+static char* read_file(const char *path) {
+    FILE *fp = fopen(path, "r");
+    if (!fp) {
+        return NULL;
+    }
+
+    char *text = NULL;
+    long size;
+    if (fseek(fp, 0, SEEK_END) == 0 && (size = ftell(fp)) >= 0 && fseek(fp, 0, SEEK_SET) == 0) {
+        text = mem_malloc(MEM_TAG_MIME, size + 1);
+        if (text && fread(text, 1, size, fp) != (size_t)size) {
+            mem_free(text);
+            text = NULL;
+        }
+        if (text) {
+            text[size] = '\0';
+        }
+    }
+    fclose(fp);
+    return text;
+}
+
+// 按扩展名排序，相同扩展名保持加载顺序，去重时保留最先出现的映射
+static int compare_entries(const void *a, const void *b) {
+    const mime_entry_t *x = a;
+    const mime_entry_t *y = b;
+    int cmp = strcmp(x->ext, y->ext);
+    if (cmp != 0) {
+        return cmp;
+    }
+    return (x > y) - (x < y);
+}
+
+static void dedup_entries(void) {
+    qsort(entries, entry_count, sizeof(*entries), compare_entries);
+    size_t kept = 0;
+    for (size_t i = 0; i < entry_count; i++) {
+        if (kept == 0 || strcmp(entries[kept - 1].ext, entries[i].ext) != 0) {
+            entries[kept++] = entries[i];
+        }
+    }
+    entry_count = kept;
+}
+
+// 尝试在 slot_count 个槽上构建，桶按大小降序依次寻找不冲突的位移；
+// fill 和 placed 是由调用者分配的临时数组，分别有 bucket_count 和 entry_count 项
+static int build_hash(size_t *order, size_t *starts, size_t *members, size_t *fill, size_t *placed) {
+    memset(slots, 0, slot_count * sizeof(*slots));
+    memset(starts, 0, (bucket_count + 1) * sizeof(*starts));
+
+    // 按桶对映射做计数排序
+    for (size_t i = 0; i < entry_count; i++) {
+        const char *ext = entries[i].ext;
+        starts[mime_hash(ext, strlen(ext), 0) % bucket_count + 1]++;
+    }
+    for (size_t b = 0; b < bucket_count; b++) {
+        starts[b + 1] += starts[b];
+        order[b] = b;
+    }
+    memcpy(fill, starts, bucket_count * sizeof(*fill));
+    for (size_t i = 0; i < entry_count; i++) {
+        const char *ext = entries[i].ext;
+        members[fill[mime_hash(ext, strlen(ext), 0) % bucket_count]++] = i;
+    }
+
+    // 大桶先放，插入排序足够
+    for (size_t i = 1; i < bucket_count; i++) {
+        size_t b = order[i];
+        size_t size = starts[b + 1] - starts[b];
+        size_t j = i;
+        while (j > 0 && starts[order[j - 1] + 1] - starts[order[j - 1]] < size) {
+            order[j] = order[j - 1];
+            j--;
+        }
+        order[j] = b;
+    }
+
+    for (size_t i = 0; i < bucket_count; i++) {
+        size_t b = order[i];
+        size_t size = starts[b + 1] - starts[b];
+        displacements[b] = 0;
+        if (size == 0) {
+            continue;
+        }
+
+        uint32_t d;
+        for (d = 1; d < MIME_DISPLACE_MAX; d++) {
+            size_t k;
+            for (k = 0; k < size; k++) {
+                const char *ext = entries[members[starts[b] + k]].ext;
+                size_t slot = mime_hash(ext, strlen(ext), d) % slot_count;
+                bool taken = slots[slot].ext != NULL;
+                for (size_t p = 0; p < k && !taken; p++) {
+                    taken = placed[p] == slot;
+                }
+                if (taken) {
+                    break;
+                }
+                placed[k] = slot;
+            }
+            if (k == size) {
+                break;
+            }
+        }
+        if (d == MIME_DISPLACE_MAX) {
+            return -1;
+        }
+
+        displacements[b] = d;
+        for (size_t k = 0; k < size; k++) {
+            slots[placed[k]] = entries[members[starts[b] + k]];
+        }
+    }
+    return 0;
+}
+
+static int build(void) {
+    bucket_count = entry_count / 4 + 1;
+    displacements = mem_calloc(MEM_TAG_MIME, bucket_count, sizeof(*displacements));
+    size_t *order = mem_malloc(MEM_TAG_MIME, bucket_count * sizeof(*order));
+    size_t *starts = mem_malloc(MEM_TAG_MIME, (bucket_count + 1) * sizeof(*starts));
+    size_t *members = mem_malloc(MEM_TAG_MIME, (entry_count + 1) * sizeof(*members));
+    size_t *fill = mem_malloc(MEM_TAG_MIME, bucket_count * sizeof(*fill));
+    size_t *placed = mem_malloc(MEM_TAG_MIME, (entry_count + 1) * sizeof(*placed));
+    int ret = -1;
+    if (!displacements || !order || !starts || !members || !fill || !placed) {
+        goto out;
+    }
+
+    // 装载率从 0.8 开始，构建失败时逐步扩大槽数组，超过上限后放弃
+    size_t slot_max = entry_count * MIME_SLOT_FACTOR_MAX + 1;
+    for (slot_count = entry_count + entry_count / 4 + 1; slot_count <= slot_max;
+         slot_count += slot_count / 4 + 1) {
+        mem_free(slots);
+        slots = mem_calloc(MEM_TAG_MIME, slot_count, sizeof(*slots));
+        if (!slots) {
+            goto out;
+        }
+        if (build_hash(order, starts, members, fill, placed) == 0) {
+            ret = 0;
+            break;
+        }
+    }
+out:
+    mem_free(order);
+    mem_free(starts);
+    mem_free(members);
+    mem_free(fill);
+    mem_free(placed);
+    return ret;
+}
+
+int mime_init(const char *path) {
+    mime_cleanup();
+
+    if (path) {
+        texts[0] = read_file(path);
+        if (!texts[0]) {
+            LOG_WARN("Cannot read %s, using built-in MIME types", path);
+        } else if (parse_types(texts[0]) != 0) {
+            goto fail;
+        }
+    }
+    texts[1] = mem_malloc(MEM_TAG_MIME, sizeof(builtin_types));
+    if (!texts[1]) {
+        goto fail;
+    }
+    memcpy(texts[1], builtin_types, sizeof(builtin_types));
+    if (parse_types(texts[1]) != 0) {
+        goto fail;
+    }
+
+    dedup_entries();
+    if (build() != 0) {
+        goto fail;
+    }
+    // 映射已全部放入槽数组
+    mem_free(entries);
+    entries = NULL;
+    entry_capacity = 0;
+
+    LOG_INFO("Loaded %zu MIME extensions into %zu slots, %zu buckets",
+             entry_count, slot_count, bucket_count);
+    return 0;
+
+fail:
+    LOG_ERROR("Failed to build MIME type table");
+    mime_cleanup();
+    return -1;
+}
+
+void mime_cleanup(void) {
+    for (size_t i = 0; i < sizeof(texts) / sizeof(texts[0]); i++) {
+        mem_free(texts[i]);
+        texts[i] = NULL;
+    }
+    mem_free(entries);
+    mem_free(slots);
+    mem_free(displacements);
+    entries = NULL;
+    slots = NULL;
+    displacements = NULL;
+    entry_count = entry_capacity = slot_count = bucket_count = 0;
+}
+
+const char* mime_lookup(const char *filename) {
+    const char *dot = strrchr(filename, '.');
+    if (!dot || slot_count == 0) {
+        return MIME_DEFAULT_TYPE;
+    }
+
+    char ext[MIME_EXT_MAX];
+    size_t len = 0;
+    for (const char *p = dot + 1; *p; p++) {
+        if (len == sizeof(ext) - 1 || *p == '/') {
+            return MIME_DEFAULT_TYPE;
+        }
+        ext[len++] = tolower((unsigned char)*p);
+    }
+    ext[len] = '\0';
+
+    uint32_t d = displacements[mime_hash(ext, len, 0) % bucket_count];
+    const mime_entry_t *slot = &slots[mime_hash(ext, len, d) % slot_count];
+    if (slot->ext && strcmp(slot->ext, ext) == 0) {
+        return slot->type;
+    }
+    return MIME_DEFAULT_TYPE;
+}
@@ -0,0 +1,18 @@
+#ifndef MIME_H
+#define MIME_H
+
+#define MIME_TYPES_DEFAULT "/etc/mime.types"
+#define MIME_DEFAULT_TYPE "application/octet-stream"
+#define MIME_EXT_MAX 16     // 扩展名长度上限，更长的视为未知类型
+
+// 加载 mime.types 格式的映射文件，内置表补充文件中缺少的扩展名，
+// 并据此构建完美哈希。path 为 NULL 或无法读取时只使用内置表。
+// 成功返回 0，内存不足时返回 -1
+int mime_init(const char *path);
+void mime_cleanup(void);
+
+// 按文件扩展名查找 MIME 类型，不区分大小写，常数时间。
+// 返回的字符串在 mime_cleanup 之前有效，映射文件同一行的扩展名返回同一指针
+const char* mime_lookup(const char *filename);
+
+#endif
@@ -0,0 +1,260 @@
+#include "open_file_cache.h"
+#include "config.h"
+#include "mem_stats.h"
+#include "logger.h"
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+static uint32_t hash_path(const char *path) {
+    // FNV-1a
+    uint32_t hash = 2166136261u;
+    for (const unsigned char *p = (const unsigned char *)path; *p; p++) {
+        hash ^= *p;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+static void lru_unlink(OpenFileCache *cache, OpenFileEntry *entry) {
+    if (entry->lru_prev) {
+        entry->lru_prev->lru_next = entry->lru_next;
+    } else {
+        cache->lru_head = entry->lru_next;
+    }
+    if (entry->lru_next) {
+        entry->lru_next->lru_prev = entry->lru_prev;
+    } else {
+        cache->lru_tail = entry->lru_prev;
+    }
+    entry->lru_prev = entry->lru_next = NULL;
+}
+
+static void lru_push_front(OpenFileCache *cache, OpenFileEntry *entry) {
+    entry->lru_prev = NULL;
+    entry->lru_next = cache->lru_head;
+    if (cache->lru_head) {
+        cache->lru_head->lru_prev = entry;
+    } else {
+        cache->lru_tail = entry;
+    }
+    cache->lru_head = entry;
+}
+
+static void entry_unref(OpenFileEntry *entry) {
+    if (--entry->refcount == 0) {
+        if (entry->fd >= 0) {
+            close(entry->fd);
+        }
+        mem_free(entry);
+    }
+}
+
+// 从缓存中摘除条目，fd 在最后一个引用释放时关闭
+static void entry_detach(OpenFileCache *cache, OpenFileEntry *entry) {
+    OpenFileEntry **link = &cache->buckets[entry->hash & (OPEN_FILE_CACHE_BUCKETS - 1)];
+    while (*link != entry) {
+        link = &(*link)->hash_next;
+    }
+    *link = entry->hash_next;
+
+    lru_unlink(cache, entry);
+    cache->entry_count--;
+    entry->cached = false;
+    entry_unref(entry);
+}
+
+static OpenFileEntry* find_entry(OpenFileCache *cache, const char *path, uint32_t hash) {
+    for (OpenFileEntry *entry = cache->buckets[hash & (OPEN_FILE_CACHE_BUCKETS - 1)];
+         entry; entry = entry->hash_next) {
+        if (entry->hash == hash && strcmp(entry->path, path) == 0) {
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+// 打开文件并记录 stat 结果，失败结果同样保存
+static OpenFileEntry* entry_open(const char *path, uint32_t hash) {
+    size_t path_len = strlen(path);
+    OpenFileEntry *entry = mem_malloc(MEM_TAG_OPEN_FILES, sizeof(OpenFileEntry) + path_len + 1);
+    if (!entry) {
+        return NULL;
+    }
+
+    memset(entry, 0, sizeof(OpenFileEntry));
+    entry->path = (char *)(entry + 1);
+    memcpy(entry->path, path, path_len + 1);
+    entry->hash = hash;
+
+    // 先 stat，只打开普通文件：打开 FIFO 会影响正在等待读者的写者
+    struct stat st;
+    if (stat(path, &st) != 0) {
+        entry->err = errno;
+        return entry;
+    }
+    entry->mode = st.st_mode;
+    entry->size = st.st_size;
+    entry->mtime = st.st_mtime;
+    entry->ino = st.st_ino;
+    if (S_ISFIFO(st.st_mode) || S_ISCHR(st.st_mode)) {
+        // 流式发送的文件由发送时自行打开，这里只记录类型
+        return entry;
+    }
+    if (!S_ISREG(st.st_mode)) {
+        // 目录、套接字等不提供服务
+        entry->err = EACCES;
+        return entry;
+    }
+
+    // stat 之后路径可能被替换为 FIFO，O_NONBLOCK 避免此时阻塞，对普通文件的读取没有影响
+    entry->fd = open(path, O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+    if (entry->fd < 0) {
+        entry->err = errno;
+    } else if (fstat(entry->fd, &st) != 0) {
+        entry->err = errno;
+        close(entry->fd);
+        entry->fd = -1;
+    } else if (!S_ISREG(st.st_mode)) {
+        entry->err = EACCES;
+        entry->mode = st.st_mode;
+        close(entry->fd);
+        entry->fd = -1;
+    } else {
+        entry->mode = st.st_mode;
+        entry->size = st.st_size;
+        entry->mtime = st.st_mtime;
+        entry->ino = st.st_ino;
+        if (g_config.prefetch_window > 0) {
+            // 路径一解析就让内核开始异步读取文件开头，发送时更可能已在页缓存中
+            posix_fadvise(entry->fd, 0, g_config.prefetch_window, POSIX_FADV_WILLNEED);
+        }
+    }
+    return entry;
+}
+
+OpenFileCache* open_file_cache_create(size_t max_entries, int ttl) {
+    OpenFileCache *cache = mem_calloc(MEM_TAG_OPEN_FILES, 1, sizeof(OpenFileCache));
+    if (!cache) {
+        return NULL;
+    }
+    cache->max_entries = max_entries;
+    cache->ttl = max_entries > 0 ? ttl : 0;
+    return cache;
+}
+
+void open_file_cache_destroy(OpenFileCache *cache) {
+    if (!cache) {
+        return;
+    }
+    open_file_cache_invalidate_all(cache);
+    mem_free(cache);
+}
+
+OpenFileEntry* open_file_cache_get(OpenFileCache *cache, const char *path) {
+    uint32_t hash = hash_path(path);
+
+    if (cache->ttl == 0) {
+        OpenFileEntry *entry = entry_open(path, hash);
+        if (entry) {
+            entry->refcount = 1;
+        }
+        return entry;
+    }
+
+    time_t now = time(NULL);
+    OpenFileEntry *entry = find_entry(cache, path, hash);
+    if (entry) {
+        if (now < entry->expires) {
+            if (entry->err) {
+                cache->negative_hits++;
+            } else {
+                cache->hits++;
+            }
+            if (cache->lru_head != entry) {
+                lru_unlink(cache, entry);
+                lru_push_front(cache, entry);
+            }
+            entry->refcount++;
+            return entry;
+        }
+
+        // 过期后重新打开，文件可能已被替换
+        cache->expirations++;
+        entry_detach(cache, entry);
+    }
+
+    cache->misses++;
+    entry = entry_open(path, hash);
+    if (!entry) {
+        return NULL;
+    }
+
+    while (cache->lru_tail && cache->entry_count >= cache->max_entries) {
+        entry_detach(cache, cache->lru_tail);
+        cache->evictions++;
+    }
+
+    entry->expires = now + cache->ttl;
+    OpenFileEntry **bucket = &cache->buckets[hash & (OPEN_FILE_CACHE_BUCKETS - 1)];
+    entry->hash_next = *bucket;
+    *bucket = entry;
+    lru_push_front(cache, entry);
+    cache->entry_count++;
+    entry->cached = true;
+
+    // 一个引用属于缓存，一个属于调用者
+    entry->refcount = 2;
+    return entry;
+}
+
+void open_file_cache_retain(OpenFileEntry *entry) {
+    entry->refcount++;
+}
+
+void open_file_cache_release(void *entry) {
+    entry_unref((OpenFileEntry *)entry);
+}
+
+void open_file_cache_invalidate(OpenFileCache *cache, const char *path) {
+    OpenFileEntry *entry = find_entry(cache, path, hash_path(path));
+    if (entry) {
+        entry_detach(cache, entry);
+    }
+}
+
+void open_file_cache_invalidate_prefix(OpenFileCache *cache, const char *dir) {
+    size_t len = strlen(dir);
+    OpenFileEntry *entry = cache->lru_head;
+    while (entry) {
+        OpenFileEntry *next = entry->lru_next;
+        if (strncmp(entry->path, dir, len) == 0 && entry->path[len] == '/') {
+            entry_detach(cache, entry);
+        }
+        entry = next;
+    }
+}
+
+void open_file_cache_invalidate_all(OpenFileCache *cache) {
+    while (cache->lru_head) {
+        entry_detach(cache, cache->lru_head);
+    }
+}
+
+void open_file_cache_dump(const OpenFileCache *cache) {
+    if (!cache) {
+        return;
+    }
+
+    LOG_INFO("Open file cache entries: %zu/%zu, ttl: %ds, hits: %zu, negative hits: %zu, misses: %zu, expirations: %zu, evictions: %zu",
+             cache->entry_count,
+             cache->max_entries,
+             cache->ttl,
+             cache->hits,
+             cache->negative_hits,
+             cache->misses,
+             cache->expirations,
+             cache->evictions);
+}
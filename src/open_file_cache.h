@@ -0,0 +1,66 @@
+#ifndef OPEN_FILE_CACHE_H
+#define OPEN_FILE_CACHE_H
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+#include <sys/types.h>
+
+#define OPEN_FILE_CACHE_BUCKETS 1024
+
+// 打开的文件描述符及其 stat 信息；err 非 0 时表示缓存的失败结果
+typedef struct OpenFileEntry {
+    char *path;
+    int fd;                     // 只有普通文件才打开，其他情况为 -1
+    int err;                    // stat/open 的 errno，成功为 0；FIFO 和字符设备以外的非普通文件为 EACCES
+    mode_t mode;
+    off_t size;
+    time_t mtime;
+    ino_t ino;
+    time_t expires;             // 超过该时间后重新打开
+    off_t resident_start;       // 已确认在页缓存中的区间，在条目有效期内不再重复检查
+    off_t resident_end;
+    int refcount;               // 缓存本身及发送队列中的引用
+    bool cached;
+    uint32_t hash;
+    struct OpenFileEntry *hash_next;
+    struct OpenFileEntry *lru_prev;
+    struct OpenFileEntry *lru_next;
+} OpenFileEntry;
+
+// 有容量上限和有效期的打开文件缓存，类似 nginx 的 open_file_cache
+typedef struct OpenFileCache {
+    size_t max_entries;
+    int ttl;                    // 条目有效期（秒），0 表示禁用缓存
+    OpenFileEntry *buckets[OPEN_FILE_CACHE_BUCKETS];
+    OpenFileEntry *lru_head;
+    OpenFileEntry *lru_tail;
+    size_t entry_count;
+
+    // 统计
+    size_t hits;
+    size_t negative_hits;
+    size_t misses;
+    size_t expirations;
+    size_t evictions;
+} OpenFileCache;
+
+OpenFileCache* open_file_cache_create(size_t max_entries, int ttl);
+void open_file_cache_destroy(OpenFileCache *cache);
+
+// 返回增加了引用计数的条目（可能是失败结果），内存不足时返回 NULL
+OpenFileEntry* open_file_cache_get(OpenFileCache *cache, const char *path);
+// 增加引用
+void open_file_cache_retain(OpenFileEntry *entry);
+// 释放引用，签名与发送队列的 release 回调一致
+void open_file_cache_release(void *entry);
+
+// 文件变化时使条目失效
+void open_file_cache_invalidate(OpenFileCache *cache, const char *path);
+void open_file_cache_invalidate_prefix(OpenFileCache *cache, const char *dir);
+void open_file_cache_invalidate_all(OpenFileCache *cache);
+
+void open_file_cache_dump(const OpenFileCache *cache);
+
+#endif
@@ -0,0 +1,155 @@
+#include "pack.h"
+#include "mem_stats.h"
+#include "logger.h"
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+static uint32_t hash_key(const char *key, size_t len) {
+    // FNV-1a
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < len; i++) {
+        hash ^= (unsigned char)key[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+// 检查索引项的所有偏移都落在映射范围内
+static bool entry_valid(const PackImage *pack, const struct pack_entry *e) {
+    return e->path_offset <= pack->size && e->path_len <= pack->size - e->path_offset &&
+           e->header_offset <= pack->size && e->header_len <= pack->size - e->header_offset &&
+           e->body_offset <= pack->size && e->body_len <= pack->size - e->body_offset;
+}
+
+static int build_index(PackImage *pack) {
+    // 负载因子不超过 1/2
+    size_t buckets = 16;
+    while (buckets < (size_t)pack->count * 2) {
+        buckets <<= 1;
+    }
+    pack->buckets = mem_calloc(MEM_TAG_FILE_CACHE, buckets, sizeof(uint32_t));
+    if (!pack->buckets) {
+        return -1;
+    }
+    pack->bucket_mask = buckets - 1;
+
+    for (uint32_t i = 0; i < pack->count; i++) {
+        const struct pack_entry *e = &pack->index[i];
+        if (!entry_valid(pack, e)) {
+            LOG_ERROR("Pack entry %u out of bounds", i);
+            return -1;
+        }
+        size_t slot = hash_key(pack_data(pack, e->path_offset), e->path_len) & pack->bucket_mask;
+        while (pack->buckets[slot]) {
+            slot = (slot + 1) & pack->bucket_mask;
+        }
+        pack->buckets[slot] = i + 1;
+    }
+    return 0;
+}
+
+PackImage* pack_open(const char *path, const char *root) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        LOG_ERROR("Cannot open pack %s: %s", path, strerror(errno));
+        return NULL;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) < 0 || (size_t)st.st_size < sizeof(struct pack_header)) {
+        LOG_ERROR("Invalid pack %s", path);
+        close(fd);
+        return NULL;
+    }
+
+    // 启动时预读全部页面，之后的请求不再产生缺页
+    void *base = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        LOG_ERROR("Cannot map pack %s: %s", path, strerror(errno));
+        return NULL;
+    }
+
+    PackImage *pack = mem_calloc(MEM_TAG_FILE_CACHE, 1, sizeof(PackImage));
+    size_t root_len = strlen(root);
+    char *root_copy = mem_malloc(MEM_TAG_FILE_CACHE, root_len + 1);
+    if (!pack || !root_copy) {
+        mem_free(pack);
+        mem_free(root_copy);
+        munmap(base, st.st_size);
+        return NULL;
+    }
+    memcpy(root_copy, root, root_len + 1);
+    pack->root = root_copy;
+    pack->base = base;
+    pack->size = st.st_size;
+
+    const struct pack_header *header = base;
+    if (memcmp(header->magic, PACK_MAGIC, sizeof(header->magic)) != 0 ||
+        header->version != PACK_VERSION || header->size != pack->size ||
+        header->index_offset > pack->size ||
+        header->count > (pack->size - header->index_offset) / sizeof(struct pack_entry) ||
+        header->index_offset % __alignof__(struct pack_entry) != 0) {
+        LOG_ERROR("Invalid or truncated pack %s", path);
+        pack_close(pack);
+        return NULL;
+    }
+    pack->index = (const struct pack_entry *)pack_data(pack, header->index_offset);
+    pack->count = header->count;
+
+    if (build_index(pack) != 0) {
+        pack_close(pack);
+        return NULL;
+    }
+
+    LOG_INFO("Pack %s mapped for %s: %u files, %zu bytes", path, root, pack->count, pack->size);
+    return pack;
+}
+
+void pack_close(PackImage *pack) {
+    if (!pack) {
+        return;
+    }
+    munmap((void *)pack->base, pack->size);
+    mem_free(pack->buckets);
+    mem_free(pack->root);
+    mem_free(pack);
+}
+
+const struct pack_entry* pack_lookup(PackImage *pack, const char *path) {
+    // 去掉文档根目录前缀得到 pack 中的相对路径
+    size_t root_len = strlen(pack->root);
+    if (strncmp(path, pack->root, root_len) != 0 || path[root_len] != '/') {
+        return NULL;
+    }
+    const char *key = path + root_len + 1;
+    size_t key_len = strlen(key);
+
+    size_t slot = hash_key(key, key_len) & pack->bucket_mask;
+    for (uint32_t i; (i = pack->buckets[slot]) != 0; slot = (slot + 1) & pack->bucket_mask) {
+        const struct pack_entry *e = &pack->index[i - 1];
+        if (e->path_len == key_len && memcmp(pack_data(pack, e->path_offset), key, key_len) == 0) {
+            pack->hits++;
+            return e;
+        }
+    }
+    pack->misses++;
+    return NULL;
+}
+
+void pack_dump(const PackImage *pack) {
+    if (!pack) {
+        return;
+    }
+
+    LOG_INFO("Pack [%s] files: %u, mapped: %zu bytes, hits: %zu, misses: %zu",
+             pack->root,
+             pack->count,
+             pack->size,
+             pack->hits,
+             pack->misses);
+}
@@ -0,0 +1,61 @@
+#ifndef PACK_H
+#define PACK_H
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#define PACK_MAGIC "LISOPACK"
+#define PACK_VERSION 1
+#define PACK_ALIGN 4096     // 文件内容按页对齐，便于直接映射和发送
+
+// pack 文件头，所有偏移均相对于文件开头，使用本机字节序
+struct pack_header {
+    char magic[8];
+    uint32_t version;
+    uint32_t count;             // 文件数
+    uint64_t index_offset;      // 按路径排序的 pack_entry 数组
+    uint64_t size;              // pack 总长度，用于发现截断
+};
+
+// 索引项：文档根目录下的相对路径、预渲染的 200 响应头（不含 Connection 头）和内容
+struct pack_entry {
+    uint64_t path_offset;
+    uint64_t header_offset;
+    uint64_t body_offset;
+    uint64_t body_len;
+    uint64_t ino;               // 打包时源文件的 inode 和修改时间，用于 ETag
+    int64_t mtime;
+    uint32_t path_len;
+    uint32_t header_len;
+};
+
+// 映射到内存的静态站点映像，只读，生命周期与服务器相同
+typedef struct PackImage {
+    char *root;                 // 对应的文档根目录，查找时去掉该前缀
+    const char *base;
+    size_t size;
+    const struct pack_entry *index;
+    uint32_t count;
+    uint32_t *buckets;          // 开放寻址哈希表，存索引下标 + 1，0 表示空槽
+    size_t bucket_mask;
+
+    // 统计
+    size_t hits;
+    size_t misses;
+} PackImage;
+
+// 映射 pack 文件并建立哈希索引，文件无效时返回 NULL
+PackImage* pack_open(const char *path, const char *root);
+void pack_close(PackImage *pack);
+
+// 按解析后的文件路径（含文档根目录）查找
+const struct pack_entry* pack_lookup(PackImage *pack, const char *path);
+
+static inline const char* pack_data(const PackImage *pack, uint64_t offset) {
+    return pack->base + offset;
+}
+
+void pack_dump(const PackImage *pack);
+
+#endif
@@ -1,7 +1,9 @@
 #include "parse.h"
+#include "mem_stats.h"
 #include <string.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <strings.h>
 
 #define default_header_capacity 16
 extern void yyrestart(FILE *input_file);
@@ -55,7 +57,7 @@ Request * parse(char *buffer, int size) {
 
     // Valid End State
     if (state == STATE_CRLFCRLF) {
-        Request *request = (Request *) malloc(sizeof(Request));
+        Request *request = (Request *) mem_malloc(MEM_TAG_REQUEST, sizeof(Request));
                 if (!request) {
             return NULL;
         }
@@ -63,9 +65,9 @@ Request * parse(char *buffer, int size) {
         memset(request, 0, sizeof(Request));
         request->header_count = 0;
         request->header_capacity = default_header_capacity;
-        request->headers = (Request_header *) malloc(sizeof(Request_header) * request->header_capacity);
+        request->headers = (Request_header *) mem_malloc(MEM_TAG_REQUEST, sizeof(Request_header) * request->header_capacity);
         if (!request->headers) {
-            free(request);
+            mem_free(request);
             return NULL;
         }
         // 设置解析选项
@@ -75,8 +77,7 @@ Request * parse(char *buffer, int size) {
         if (yyparse() == SUCCESS) {
             // 验证必需的字段
             if (!request->http_method || !request->http_uri || !request->http_version) {
-                free(request->headers);
-                free(request);
+                free_request(request);
                 return NULL;
             }
 
@@ -91,11 +92,59 @@ Request * parse(char *buffer, int size) {
             }
         } else {
             yyrestart(yyin); // 重置输入文件
-            free(request->headers);
-            free(request);
+            free_request(request);
         }
     }
 
     printf("Parsing Failed\n");
     return NULL;
 }
+
+/**
+* Release a request returned by parse()
+*/
+void free_request(Request *request) {
+    if (!request) {
+        return;
+    }
+    mem_free(request->headers);
+    mem_free(request);
+}
+
+/**
+* Returns the value of the first header named name (case-insensitive), or NULL
+*/
+const char *request_get_header(const Request *request, const char *name) {
+    for (int i = 0; i < request->header_count; i++) {
+        if (strcasecmp(request->headers[i].header_name, name) == 0) {
+            return request->headers[i].header_value;
+        }
+    }
+    return NULL;
+}
+
+/**
+* Checks whether a comma-separated header value contains token (case-insensitive)
+*/
+int header_has_token(const char *value, const char *token) {
+    size_t token_len = strlen(token);
+    const char *p = value;
+
+    while (*p) {
+        while (*p == ' ' || *p == '\t' || *p == ',') {
+            p++;
+        }
+        const char *start = p;
+        while (*p && *p != ',') {
+            p++;
+        }
+        const char *end = p;
+        while (end > start && (end[-1] == ' ' || end[-1] == '\t')) {
+            end--;
+        }
+        if ((size_t)(end - start) == token_len && strncasecmp(start, token, token_len) == 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
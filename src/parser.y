@@ -6,6 +6,7 @@
 
 %{
 #include "parse.h"
+#include "mem_stats.h"
 
 /* Define YACCDEBUG to enable debug messages for this lex file */
 #define YACCDEBUG
@@ -208,7 +209,7 @@ request_header: token ows t_colon ows text ows t_crlf {
 	// YPRINTF("request_Header:\n%s\n%s\n",$1,$5);
 	if (parsing_request->header_count == parsing_request->header_capacity){
         parsing_request->header_capacity *= 2 ;
-        if ((parsing_request->headers = (Request_header *) realloc(parsing_request->headers, 
+        if ((parsing_request->headers = (Request_header *) mem_realloc(MEM_TAG_REQUEST, parsing_request->headers, 
              sizeof(Request_header) * parsing_request->header_capacity)) == NULL){
             yyerror ("Can not allocate memory for HTTP request headers.") ;
             return -1 ;
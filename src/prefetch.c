@@ -0,0 +1,254 @@
+#include "prefetch.h"
+#include "mem_stats.h"
+#include "logger.h"
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/eventfd.h>
+
+#define PREFETCH_READ_CHUNK (64 * 1024)   // 后台线程单次 pread 的长度
+#define PREFETCH_CHECK_PAGES 256          // mincore 最多检查的页数，超出部分不检查
+
+static void job_unref(PrefetchJob *job) {
+    if (--job->refcount > 0) {
+        return;
+    }
+    open_file_cache_release(job->file);
+    mem_free(job);
+}
+
+// 后台线程：逐个读取任务区间，数据进入页缓存后通知事件循环
+static void* prefetch_main(void *arg) {
+    Prefetcher *prefetcher = arg;
+    char *buf = mem_malloc(MEM_TAG_PREFETCH, PREFETCH_READ_CHUNK);
+    if (!buf) {
+        LOG_ERROR("Failed to allocate prefetch buffer");
+    }
+
+    pthread_mutex_lock(&prefetcher->lock);
+    while (!prefetcher->stopping) {
+        PrefetchJob *job = prefetcher->queue_head;
+        if (!job) {
+            pthread_cond_wait(&prefetcher->cond, &prefetcher->lock);
+            continue;
+        }
+        prefetcher->queue_head = job->next;
+        if (!prefetcher->queue_head) {
+            prefetcher->queue_tail = NULL;
+        }
+        pthread_mutex_unlock(&prefetcher->lock);
+
+        // 读取失败时同样完成任务，由 sendfile 报告错误
+        size_t done = 0;
+        while (buf && done < job->len) {
+            size_t len = job->len - done < PREFETCH_READ_CHUNK ? job->len - done : PREFETCH_READ_CHUNK;
+            ssize_t n = pread(job->file->fd, buf, len, job->offset + done);
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            if (n <= 0) {
+                break;
+            }
+            done += n;
+        }
+
+        pthread_mutex_lock(&prefetcher->lock);
+        job->next = prefetcher->completed;
+        prefetcher->completed = job;
+        uint64_t one = 1;
+        if (write(prefetcher->event_fd, &one, sizeof(one)) < 0 && errno != EAGAIN) {
+            LOG_ERROR("Failed to signal prefetch completion: %s", strerror(errno));
+        }
+    }
+    pthread_mutex_unlock(&prefetcher->lock);
+
+    mem_free(buf);
+    return NULL;
+}
+
+Prefetcher* prefetch_create(size_t window) {
+    Prefetcher *prefetcher = mem_calloc(MEM_TAG_PREFETCH, 1, sizeof(Prefetcher));
+    if (!prefetcher) {
+        return NULL;
+    }
+    prefetcher->window = window;
+
+    prefetcher->event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (prefetcher->event_fd < 0) {
+        LOG_ERROR("Failed to create prefetch eventfd: %s", strerror(errno));
+        mem_free(prefetcher);
+        return NULL;
+    }
+
+    pthread_mutex_init(&prefetcher->lock, NULL);
+    pthread_cond_init(&prefetcher->cond, NULL);
+    int err = pthread_create(&prefetcher->thread, NULL, prefetch_main, prefetcher);
+    if (err != 0) {
+        LOG_ERROR("Failed to start prefetch thread: %s", strerror(err));
+        pthread_cond_destroy(&prefetcher->cond);
+        pthread_mutex_destroy(&prefetcher->lock);
+        close(prefetcher->event_fd);
+        mem_free(prefetcher);
+        return NULL;
+    }
+    return prefetcher;
+}
+
+// 释放后台线程持有的引用
+static void release_list(PrefetchJob *job) {
+    while (job) {
+        PrefetchJob *next = job->next;
+        job->done = true;
+        job_unref(job);
+        job = next;
+    }
+}
+
+void prefetch_destroy(Prefetcher *prefetcher) {
+    if (!prefetcher) {
+        return;
+    }
+
+    pthread_mutex_lock(&prefetcher->lock);
+    prefetcher->stopping = true;
+    pthread_cond_signal(&prefetcher->cond);
+    pthread_mutex_unlock(&prefetcher->lock);
+    pthread_join(prefetcher->thread, NULL);
+
+    release_list(prefetcher->queue_head);
+    release_list(prefetcher->completed);
+    pthread_cond_destroy(&prefetcher->cond);
+    pthread_mutex_destroy(&prefetcher->lock);
+    close(prefetcher->event_fd);
+    mem_free(prefetcher);
+}
+
+int prefetch_fd(const Prefetcher *prefetcher) {
+    return prefetcher ? prefetcher->event_fd : -1;
+}
+
+void prefetch_process(Prefetcher *prefetcher) {
+    uint64_t count;
+    if (read(prefetcher->event_fd, &count, sizeof(count)) < 0 && errno != EAGAIN) {
+        LOG_ERROR("Failed to read prefetch eventfd: %s", strerror(errno));
+    }
+
+    pthread_mutex_lock(&prefetcher->lock);
+    PrefetchJob *job = prefetcher->completed;
+    prefetcher->completed = NULL;
+    pthread_mutex_unlock(&prefetcher->lock);
+
+    while (job) {
+        PrefetchJob *next = job->next;
+        prefetcher->finished++;
+        job->done = true;
+        job->file->resident_start = job->offset;
+        job->file->resident_end = job->offset + job->len;
+        job_unref(job);
+        job = next;
+    }
+}
+
+// 通过 mincore 检查区间的各页是否都在页缓存中
+static bool is_resident(int fd, off_t offset, size_t len) {
+    static long page_size;
+    if (!page_size) {
+        page_size = sysconf(_SC_PAGESIZE);
+    }
+
+    off_t start = offset & ~(off_t)(page_size - 1);
+    len += offset - start;
+    if (len > (size_t)PREFETCH_CHECK_PAGES * page_size) {
+        len = (size_t)PREFETCH_CHECK_PAGES * page_size;
+    }
+
+    void *addr = mmap(NULL, len, PROT_READ, MAP_SHARED, fd, start);
+    if (addr == MAP_FAILED) {
+        // 无法判断时按已常驻处理，退回原来的同步发送
+        return true;
+    }
+
+    unsigned char vec[PREFETCH_CHECK_PAGES];
+    bool resident = mincore(addr, len, vec) != 0;
+    if (!resident) {
+        size_t pages = (len + page_size - 1) / page_size;
+        resident = true;
+        for (size_t i = 0; i < pages; i++) {
+            if (!(vec[i] & 1)) {
+                resident = false;
+                break;
+            }
+        }
+    }
+    munmap(addr, len);
+    return resident;
+}
+
+PrefetchJob* prefetch_check(Prefetcher *prefetcher, OpenFileEntry *file, off_t offset, size_t len) {
+    if (len > prefetcher->window) {
+        len = prefetcher->window;
+    }
+    if (len == 0) {
+        return NULL;
+    }
+    // 页缓存可能在条目有效期内回收这些页，此时退化为同步读取，与不预读时相同
+    if (offset >= file->resident_start && offset + (off_t)len <= file->resident_end) {
+        prefetcher->hits++;
+        prefetcher->known++;
+        return NULL;
+    }
+    if (is_resident(file->fd, offset, len)) {
+        prefetcher->hits++;
+        file->resident_start = offset;
+        file->resident_end = offset + len;
+        return NULL;
+    }
+
+    PrefetchJob *job = mem_calloc(MEM_TAG_PREFETCH, 1, sizeof(PrefetchJob));
+    if (!job) {
+        // 内存不足时不等待预读
+        return NULL;
+    }
+    prefetcher->misses++;
+    open_file_cache_retain(file);
+    job->owner = prefetcher;
+    job->file = file;
+    job->offset = offset;
+    job->len = len;
+    job->refcount = 2;
+
+    pthread_mutex_lock(&prefetcher->lock);
+    if (prefetcher->queue_tail) {
+        prefetcher->queue_tail->next = job;
+    } else {
+        prefetcher->queue_head = job;
+    }
+    prefetcher->queue_tail = job;
+    pthread_cond_signal(&prefetcher->cond);
+    pthread_mutex_unlock(&prefetcher->lock);
+    return job;
+}
+
+bool prefetch_ready(const PrefetchJob *job) {
+    return job->done;
+}
+
+void prefetch_release(PrefetchJob *job) {
+    if (job) {
+        job_unref(job);
+    }
+}
+
+void prefetch_dump(const Prefetcher *prefetcher) {
+    if (!prefetcher) {
+        return;
+    }
+
+    LOG_INFO("Prefetch window: %zu bytes, resident hits: %zu (%zu without mincore), stalled misses: %zu, completed: %zu",
+             prefetcher->window,
+             prefetcher->hits,
+             prefetcher->known,
+             prefetcher->misses,
+             prefetcher->finished);
+}
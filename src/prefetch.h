@@ -0,0 +1,58 @@
+#ifndef PREFETCH_H
+#define PREFETCH_H
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include "open_file_cache.h"
+
+// 预读任务：后台线程把文件的一段读入页缓存，完成前引用它的发送段不发送
+typedef struct PrefetchJob {
+    struct Prefetcher *owner;
+    OpenFileEntry *file;        // 持有引用
+    off_t offset;
+    size_t len;
+    bool done;                  // 只由事件循环线程读写
+    int refcount;               // 发送段和后台线程各一个，只由事件循环线程修改
+    struct PrefetchJob *next;
+} PrefetchJob;
+
+// 冷文件预读：检查文件开头一段是否已在页缓存中，不在时交给后台线程读取，
+// 读完后通过 eventfd 通知事件循环，避免事件循环在磁盘 I/O 上阻塞
+typedef struct Prefetcher {
+    size_t window;              // 发送前要求常驻内存的字节数
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    PrefetchJob *queue_head;    // 等待后台线程读取
+    PrefetchJob *queue_tail;
+    PrefetchJob *completed;     // 已读完，等待事件循环处理
+    bool stopping;
+    int event_fd;
+
+    // 统计
+    size_t hits;                // 检查时已常驻内存
+    size_t known;               // 其中区间已确认常驻、跳过 mincore 的次数
+    size_t misses;              // 需要等待预读
+    size_t finished;
+} Prefetcher;
+
+Prefetcher* prefetch_create(size_t window);
+void prefetch_destroy(Prefetcher *prefetcher);
+
+// 后台线程完成任务时可读
+int prefetch_fd(const Prefetcher *prefetcher);
+// 处理已完成的任务，事件循环在 prefetch_fd 可读时调用
+void prefetch_process(Prefetcher *prefetcher);
+
+// 检查 [offset, offset + len) 的开头是否常驻内存；是则返回 NULL，
+// 否则提交预读任务并返回持有一个引用的任务，由调用者通过 prefetch_release 释放。
+// 检查结果和完成的预读记录在 file 上，同一条目的后续请求不再调用 mincore
+PrefetchJob* prefetch_check(Prefetcher *prefetcher, OpenFileEntry *file, off_t offset, size_t len);
+bool prefetch_ready(const PrefetchJob *job);
+void prefetch_release(PrefetchJob *job);
+
+void prefetch_dump(const Prefetcher *prefetcher);
+
+#endif
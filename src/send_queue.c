@@ -0,0 +1,388 @@
+#include "send_queue.h"
+#include "mem_stats.h"
+#include "logger.h"
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/sendfile.h>
+
+// 单次 sendmsg 最多聚合的段数
+#define SEND_IOV_MAX 64
+
+// 因额度用完而让出事件循环的次数
+static size_t yields;
+
+SendQueue* send_queue_create(BufferPool *pool) {
+    SendQueue *queue = mem_calloc(MEM_TAG_RESPONSE, 1, sizeof(SendQueue));
+    if (!queue) {
+        return NULL;
+    }
+    queue->pool = pool;
+    return queue;
+}
+
+static void segment_release(struct SendSegment *seg) {
+    prefetch_release(seg->prefetch);
+    switch (seg->type) {
+        case SEG_HEAP:
+            mem_free((void *)seg->data);
+            break;
+        case SEG_FILE:
+            if (seg->release) {
+                seg->release(seg->release_ctx);
+            } else {
+                close(seg->fd);
+            }
+            break;
+        case SEG_REF:
+            if (seg->release) {
+                seg->release(seg->release_ctx);
+            }
+            break;
+        case SEG_STREAM:
+            splice_stream_destroy(seg->stream);
+            break;
+        case SEG_ARENA:
+            break;
+    }
+    mem_free(seg);
+}
+
+// 队列清空后归还发送缓冲区，空闲连接不占用发送内存
+static void release_arena(SendQueue *queue) {
+    if (queue->arena) {
+        buffer_pool_put(queue->pool, queue->arena);
+        queue->arena = NULL;
+        queue->arena_used = 0;
+    }
+}
+
+void send_queue_destroy(SendQueue *queue) {
+    if (!queue) {
+        return;
+    }
+
+    struct SendSegment *current = queue->head;
+    while (current) {
+        struct SendSegment *next = current->next;
+        segment_release(current);
+        current = next;
+    }
+
+    release_arena(queue);
+    mem_free(queue);
+}
+
+static struct SendSegment* push_segment(SendQueue *queue, seg_type_t type, const char *data, size_t len) {
+    struct SendSegment *seg = mem_malloc(MEM_TAG_RESPONSE, sizeof(struct SendSegment));
+    if (!seg) {
+        return NULL;
+    }
+
+    seg->type = type;
+    seg->data = data;
+    seg->fd = -1;
+    seg->file_offset = 0;
+    seg->release = NULL;
+    seg->release_ctx = NULL;
+    seg->stream = NULL;
+    seg->prefetch = NULL;
+    seg->len = len;
+    seg->offset = 0;
+    seg->end_of_response = false;
+    seg->next = NULL;
+
+    if (queue->tail) {
+        queue->tail->next = seg;
+        queue->tail = seg;
+    } else {
+        queue->head = queue->tail = seg;
+    }
+    queue->pending_bytes += len;
+    return seg;
+}
+
+char* send_queue_reserve(SendQueue *queue, size_t len) {
+    if (!queue->arena) {
+        queue->arena = buffer_pool_get(queue->pool);
+        queue->arena_used = 0;
+    }
+
+    if (queue->arena && queue->arena_used + len <= queue->pool->block_size) {
+        return queue->arena + queue->arena_used;
+    }
+
+    // 发送缓冲区放不下时单独分配
+    queue->reserved_heap = mem_malloc(MEM_TAG_RESPONSE, len);
+    return queue->reserved_heap;
+}
+
+bool send_queue_commit(SendQueue *queue, size_t len) {
+    if (queue->reserved_heap) {
+        char *data = queue->reserved_heap;
+        queue->reserved_heap = NULL;
+        if (len == 0 || !push_segment(queue, SEG_HEAP, data, len)) {
+            mem_free(data);
+            return len == 0;
+        }
+        return true;
+    }
+
+    if (len == 0) {
+        return true;
+    }
+
+    char *dst = queue->arena + queue->arena_used;
+    queue->arena_used += len;
+
+    // 与上一段在发送缓冲区中相邻时直接合并
+    struct SendSegment *tail = queue->tail;
+    if (tail && tail->type == SEG_ARENA && !tail->end_of_response &&
+        tail->data + tail->len == dst) {
+        tail->len += len;
+        queue->pending_bytes += len;
+        return true;
+    }
+    return push_segment(queue, SEG_ARENA, dst, len) != NULL;
+}
+
+bool send_queue_append(SendQueue *queue, const void *data, size_t len) {
+    if (len == 0) {
+        return true;
+    }
+
+    char *dst = send_queue_reserve(queue, len);
+    if (!dst) {
+        return false;
+    }
+    memcpy(dst, data, len);
+    return send_queue_commit(queue, len);
+}
+
+bool send_queue_append_file(SendQueue *queue, int fd, off_t offset, size_t len) {
+    struct SendSegment *seg = push_segment(queue, SEG_FILE, NULL, len);
+    if (!seg) {
+        close(fd);
+        return false;
+    }
+    seg->fd = fd;
+    seg->file_offset = offset;
+    return true;
+}
+
+bool send_queue_append_stream(SendQueue *queue, SpliceStream *stream) {
+    struct SendSegment *seg = push_segment(queue, SEG_STREAM, NULL, 0);
+    if (!seg) {
+        splice_stream_destroy(stream);
+        return false;
+    }
+    seg->stream = stream;
+    return true;
+}
+
+bool send_queue_append_file_ref(SendQueue *queue, int fd, off_t offset, size_t len,
+                                void (*release)(void *ctx), void *ctx) {
+    struct SendSegment *seg = push_segment(queue, SEG_FILE, NULL, len);
+    if (!seg) {
+        release(ctx);
+        return false;
+    }
+    seg->fd = fd;
+    seg->file_offset = offset;
+    seg->release = release;
+    seg->release_ctx = ctx;
+    return true;
+}
+
+bool send_queue_append_ref(SendQueue *queue, const void *data, size_t len,
+                           void (*release)(void *ctx), void *ctx) {
+    struct SendSegment *seg = push_segment(queue, SEG_REF, data, len);
+    if (!seg) {
+        if (release) {
+            release(ctx);
+        }
+        return false;
+    }
+    seg->release = release;
+    seg->release_ctx = ctx;
+    return true;
+}
+
+void send_queue_wait_prefetch(SendQueue *queue, PrefetchJob *job) {
+    if (!queue->tail) {
+        prefetch_release(job);
+        return;
+    }
+    prefetch_release(queue->tail->prefetch);
+    queue->tail->prefetch = job;
+}
+
+void send_queue_end_response(SendQueue *queue) {
+    if (queue->tail && !queue->tail->end_of_response) {
+        queue->tail->end_of_response = true;
+        queue->pending_responses++;
+    }
+}
+
+// 移除并释放队首的段
+static void pop_head(SendQueue *queue) {
+    struct SendSegment *seg = queue->head;
+    if (seg->end_of_response) {
+        queue->pending_responses--;
+    }
+    queue->head = seg->next;
+    if (!queue->head) {
+        queue->tail = NULL;
+    }
+    segment_release(seg);
+}
+
+// 释放已发送完的段
+static void consume(SendQueue *queue, size_t sent) {
+    queue->pending_bytes -= sent;
+
+    while (sent > 0) {
+        struct SendSegment *seg = queue->head;
+        size_t left = seg->len - seg->offset;
+
+        if (sent < left) {
+            seg->offset += sent;
+            return;
+        }
+
+        sent -= left;
+        pop_head(queue);
+    }
+}
+
+// 通过 sendfile 发送队首的文件段，最多 limit 字节，偏移量记录在段中以便下次继续
+static ssize_t flush_file(struct SendSegment *seg, int sockfd, size_t limit) {
+    off_t offset = seg->file_offset + seg->offset;
+    size_t len = seg->len - seg->offset;
+    if (len > limit) {
+        len = limit;
+    }
+    ssize_t sent = sendfile(sockfd, seg->fd, &offset, len);
+    if (sent == 0) {
+        // 文件在发送过程中被截断，无法满足已发送的 Content-Length
+        errno = EIO;
+        return -1;
+    }
+    return sent;
+}
+
+// 聚合队首连续的内存段，用一次 sendmsg 发送，最多 limit 字节
+static ssize_t flush_memory(SendQueue *queue, int sockfd, size_t limit) {
+    struct iovec iov[SEND_IOV_MAX];
+    int iovcnt = 0;
+    struct SendSegment *seg;
+
+    for (seg = queue->head;
+         seg && seg->type != SEG_FILE && seg->type != SEG_STREAM && !seg->prefetch &&
+         iovcnt < SEND_IOV_MAX && limit > 0;
+         seg = seg->next) {
+        size_t len = seg->len - seg->offset;
+        if (len > limit) {
+            len = limit;
+        }
+        iov[iovcnt].iov_base = (char *)seg->data + seg->offset;
+        iov[iovcnt].iov_len = len;
+        iovcnt++;
+        limit -= len;
+    }
+
+    // 后面紧跟 sendfile 文件内容且本轮会继续发送时加 MSG_MORE，
+    // 让响应头与文件开头共用一个 TCP 段，而不是单独发出一个小包；
+    // 流的来源可能暂时没有数据、文件内容可能还在预读，都不能让响应头等待
+    int flags = MSG_NOSIGNAL;
+    if (seg && seg->type == SEG_FILE && !seg->prefetch && limit > 0) {
+        flags |= MSG_MORE;
+    }
+
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = iov;
+    msg.msg_iovlen = iovcnt;
+    return sendmsg(sockfd, &msg, flags);
+}
+
+int send_queue_flush(SendQueue *queue, int sockfd, size_t budget) {
+    while (queue->head) {
+        // 本轮额度用完后让出事件循环，剩余数据等下次可写时继续发送
+        if (budget == 0) {
+            yields++;
+            return 0;
+        }
+
+        // 文件内容尚未读入页缓存，等预读完成后再发送，避免 sendfile 阻塞在磁盘上
+        if (queue->head->prefetch) {
+            if (!prefetch_ready(queue->head->prefetch)) {
+                return 0;
+            }
+            prefetch_release(queue->head->prefetch);
+            queue->head->prefetch = NULL;
+        }
+
+        ssize_t sent;
+        if (queue->head->type == SEG_STREAM) {
+            sent = splice_stream_flush(queue->head->stream, sockfd, budget);
+        } else if (queue->head->type == SEG_FILE) {
+            sent = flush_file(queue->head, sockfd, budget);
+        } else {
+            sent = flush_memory(queue, sockfd, budget);
+        }
+        if (sent < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                // 等待 socket 可写后继续
+                return 0;
+            }
+            LOG_ERROR("Failed to send response: %s", strerror(errno));
+            return -1;
+        }
+
+        budget -= sent;
+        if (queue->head->type != SEG_STREAM) {
+            consume(queue, (size_t)sent);
+            continue;
+        }
+
+        // 流没有结束时是额度用完、socket 写满或来源暂无数据，都等下次事件再继续
+        if (!splice_stream_done(queue->head->stream)) {
+            if (budget == 0) {
+                yields++;
+            }
+            return 0;
+        }
+        pop_head(queue);
+    }
+
+    release_arena(queue);
+    return 0;
+}
+
+bool send_queue_empty(const SendQueue *queue) {
+    return queue->head == NULL;
+}
+
+int send_queue_waiting_fd(const SendQueue *queue) {
+    if (!queue->head) {
+        return -1;
+    }
+    if (queue->head->prefetch) {
+        return prefetch_ready(queue->head->prefetch) ? -1 : prefetch_fd(queue->head->prefetch->owner);
+    }
+    if (queue->head->type != SEG_STREAM) {
+        return -1;
+    }
+    return splice_stream_waiting_fd(queue->head->stream);
+}
+
+void send_queue_dump_stats(void) {
+    LOG_INFO("[send_queue] yields=%zu", yields);
+}
@@ -0,0 +1,81 @@
+#ifndef SEND_QUEUE_H
+#define SEND_QUEUE_H
+
+#include "buffer_pool.h"
+#include "splice_stream.h"
+#include "prefetch.h"
+#include <stdlib.h>
+#include <stdbool.h>
+#include <sys/types.h>
+
+// 待发送数据段类型
+typedef enum {
+    SEG_ARENA,      // 位于连接发送缓冲区中的数据
+    SEG_HEAP,       // 发送缓冲区放不下时单独分配的数据
+    SEG_FILE,       // 文件内容，通过 sendfile 从 fd 直接发送
+    SEG_REF,        // 引用外部数据（如文件缓存条目），发送完成后调用 release
+    SEG_STREAM      // 长度未知的流，发送到来源结束为止
+} seg_type_t;
+
+// 待发送数据段
+struct SendSegment {
+    seg_type_t type;
+    const char *data;
+    int fd;                     // SEG_FILE 的文件描述符，无 release 时发送完成后关闭
+    off_t file_offset;          // SEG_FILE 在文件中的起始位置
+    void (*release)(void *ctx); // SEG_REF 及共享 fd 的 SEG_FILE 的释放回调
+    void *release_ctx;
+    SpliceStream *stream;       // SEG_STREAM 的流，由段持有
+    PrefetchJob *prefetch;      // 预读完成前不发送该段，段持有一个引用
+    size_t len;
+    size_t offset;              // 已发送字节数
+    bool end_of_response;       // 该段是否为某个响应的最后一段
+    struct SendSegment *next;
+};
+
+// 连接的发送队列，一批请求的响应汇总后用一次 sendmsg 发出
+typedef struct SendQueue {
+    struct SendSegment *head;
+    struct SendSegment *tail;
+    BufferPool *pool;           // 发送缓冲区所属的池
+    char *arena;                // 发送缓冲区，按需从池中获取
+    size_t arena_used;
+    char *reserved_heap;        // send_queue_reserve 在堆上预留的空间
+    size_t pending_bytes;       // 尚未发送的字节数
+    int pending_responses;      // 尚未发送完成的响应数
+} SendQueue;
+
+SendQueue* send_queue_create(BufferPool *pool);
+void send_queue_destroy(SendQueue *queue);
+
+// 在队列末尾预留 len 字节可写空间，写入后调用 send_queue_commit 提交实际长度
+char* send_queue_reserve(SendQueue *queue, size_t len);
+bool send_queue_commit(SendQueue *queue, size_t len);
+// 复制数据到发送队列
+bool send_queue_append(SendQueue *queue, const void *data, size_t len);
+// 追加文件区间，队列接管 fd 的所有权
+bool send_queue_append_file(SendQueue *queue, int fd, off_t offset, size_t len);
+// 追加共享 fd 的文件区间，发送完成后调用 release(ctx) 而不关闭 fd
+bool send_queue_append_file_ref(SendQueue *queue, int fd, off_t offset, size_t len,
+                                void (*release)(void *ctx), void *ctx);
+// 追加外部数据的引用，发送完成或队列销毁时调用 release(ctx)；数据生命周期长于队列时 release 可为 NULL
+bool send_queue_append_ref(SendQueue *queue, const void *data, size_t len,
+                           void (*release)(void *ctx), void *ctx);
+// 追加长度未知的流，队列接管流的所有权
+bool send_queue_append_stream(SendQueue *queue, SpliceStream *stream);
+// 队尾段等到预读任务完成后再发送，队列接管 job 的引用
+void send_queue_wait_prefetch(SendQueue *queue, PrefetchJob *job);
+// 标记当前响应已完整入队
+void send_queue_end_response(SendQueue *queue);
+
+// 发送至多 budget 字节，socket 写满或额度用完时返回，剩余数据留待下次可写时继续；
+// 返回 0 表示正常（可能仍有剩余），-1 表示连接出错
+int send_queue_flush(SendQueue *queue, int sockfd, size_t budget);
+bool send_queue_empty(const SendQueue *queue);
+// 队首的流正在等待来源数据或队首段正在等待预读时返回要等待可读的 fd，
+// 此时应等待它可读而不是 socket 可写；否则返回 -1
+int send_queue_waiting_fd(const SendQueue *queue);
+// 输出因额度用完而让出事件循环的次数
+void send_queue_dump_stats(void);
+
+#endif
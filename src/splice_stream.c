@@ -0,0 +1,289 @@
+#define _GNU_SOURCE
+#include "splice_stream.h"
+#include "http_builder.h"
+#include "mem_stats.h"
+#include "logger.h"
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/socket.h>
+
+#define FRAMING_MAX 32
+
+// 单个路径的发送统计
+struct splice_stat {
+    char path[SPLICE_PATH_MAX];
+    size_t transfers;
+    size_t spliced;             // 经管道在内核中转发的字节数
+    size_t copied;              // 回退到 read/send 复制的字节数
+};
+
+static struct splice_stat stats[SPLICE_STATS_MAX];
+static size_t stat_count;
+
+struct SpliceStream {
+    int fd;                     // 来源
+    bool owns_fd;               // 销毁时是否关闭来源
+    size_t remaining;           // 来源还需读取的字节数，SIZE_MAX 表示读到来源结束
+    int sink_fd;                // 非负时数据写入该 fd 而不是发往 socket
+    off_t sink_off;             // sink 中下一个写入位置，各流写入各自预留的区间
+    int pipe_fds[2];            // 本次传输专用的管道，-1 表示回退到 read/send
+    char *buf;                  // 回退路径的缓冲区，按需分配
+    size_t buf_off;
+    size_t pending;             // 已读入管道或缓冲区、尚未发出的字节数
+    char framing[FRAMING_MAX];  // 待发送的分块头或结束块
+    size_t framing_len;
+    size_t framing_off;
+    bool chunked;
+    bool crlf_due;              // 上一块数据已发完，下一段分块编码前需补上 \r\n
+    bool eof;
+    bool waiting;               // 来源暂时没有数据
+    struct splice_stat *stat;
+};
+
+// 表满后新路径都计入最后一项
+static struct splice_stat* stat_get(const char *path) {
+    for (size_t i = 0; i < stat_count; i++) {
+        if (strcmp(stats[i].path, path) == 0) {
+            return &stats[i];
+        }
+    }
+
+    struct splice_stat *stat = &stats[stat_count < SPLICE_STATS_MAX ? stat_count : SPLICE_STATS_MAX - 1];
+    if (stat_count < SPLICE_STATS_MAX - 1) {
+        snprintf(stat->path, sizeof(stat->path), "%s", path);
+        stat_count++;
+    } else if (stat_count == SPLICE_STATS_MAX - 1) {
+        snprintf(stat->path, sizeof(stat->path), "(other)");
+        stat_count++;
+    }
+    return stat;
+}
+
+static void close_pipe(SpliceStream *stream) {
+    for (int i = 0; i < 2; i++) {
+        if (stream->pipe_fds[i] >= 0) {
+            close(stream->pipe_fds[i]);
+            stream->pipe_fds[i] = -1;
+        }
+    }
+}
+
+static SpliceStream* stream_new(const char *path, int fd) {
+    SpliceStream *stream = mem_calloc(MEM_TAG_RESPONSE, 1, sizeof(SpliceStream));
+    if (!stream) {
+        return NULL;
+    }
+
+    stream->fd = fd;
+    stream->remaining = SIZE_MAX;
+    stream->sink_fd = -1;
+    if (pipe2(stream->pipe_fds, O_NONBLOCK | O_CLOEXEC) != 0) {
+        LOG_WARN("Failed to create splice pipe for %s: %s", path, strerror(errno));
+        stream->pipe_fds[0] = stream->pipe_fds[1] = -1;
+    }
+    stream->stat = stat_get(path);
+    stream->stat->transfers++;
+    return stream;
+}
+
+SpliceStream* splice_stream_create(const char *path, int fd, bool chunked) {
+    SpliceStream *stream = stream_new(path, fd);
+    if (!stream) {
+        close(fd);
+        return NULL;
+    }
+    stream->owns_fd = true;
+    stream->chunked = chunked;
+    return stream;
+}
+
+SpliceStream* splice_stream_create_body(const char *label, int fd, size_t len, int sink_fd, off_t sink_off) {
+    SpliceStream *stream = stream_new(label, fd);
+    if (!stream) {
+        return NULL;
+    }
+    stream->remaining = len;
+    stream->sink_fd = sink_fd;
+    stream->sink_off = sink_off;
+    stream->eof = len == 0;
+    return stream;
+}
+
+void splice_stream_destroy(SpliceStream *stream) {
+    if (!stream) {
+        return;
+    }
+    if (stream->owns_fd) {
+        close(stream->fd);
+    }
+    close_pipe(stream);
+    mem_free(stream->buf);
+    mem_free(stream);
+}
+
+// 准备分块编码：补上一块的结尾，再写块长度；长度为 0 时是结束块
+static void set_framing(SpliceStream *stream, size_t chunk_len) {
+    http_builder_t b;
+    http_builder_init(&b, stream->framing, sizeof(stream->framing));
+    if (stream->crlf_due) {
+        http_builder_literal(&b, "\r\n");
+        stream->crlf_due = false;
+    }
+    http_builder_hex(&b, chunk_len);
+    http_builder_literal(&b, "\r\n");
+    if (chunk_len == 0) {
+        http_builder_literal(&b, "\r\n");
+    }
+    stream->framing_len = b.len;
+    stream->framing_off = 0;
+}
+
+// 从来源读入下一块，返回字节数，0 表示来源结束
+static ssize_t stream_fill(SpliceStream *stream, size_t limit) {
+    size_t len = limit < SPLICE_STREAM_CHUNK ? limit : SPLICE_STREAM_CHUNK;
+    if (len > stream->remaining) {
+        len = stream->remaining;
+    }
+
+    if (stream->pipe_fds[1] >= 0) {
+        ssize_t n = splice(stream->fd, NULL, stream->pipe_fds[1], NULL, len,
+                           SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+        if (n >= 0 || errno != EINVAL) {
+            return n;
+        }
+        // 来源不支持 splice，改为经用户态缓冲区复制
+        LOG_INFO("splice not supported for %s, falling back to read/send", stream->stat->path);
+        close_pipe(stream);
+    }
+
+    if (!stream->buf) {
+        stream->buf = mem_malloc(MEM_TAG_RESPONSE, SPLICE_STREAM_CHUNK);
+        if (!stream->buf) {
+            errno = ENOMEM;
+            return -1;
+        }
+    }
+    stream->buf_off = 0;
+    return read(stream->fd, stream->buf, len);
+}
+
+// 发出已读入的数据，有 sink 时写入 sink
+static ssize_t stream_drain(SpliceStream *stream, int sockfd, size_t limit) {
+    size_t len = stream->pending < limit ? stream->pending : limit;
+    bool to_sink = stream->sink_fd >= 0;
+    int out = to_sink ? stream->sink_fd : sockfd;
+    ssize_t n;
+
+    if (stream->pipe_fds[0] >= 0) {
+        // 写入 sink 时由内核按 sink_off 定位并更新它，不使用文件的共享偏移
+        n = splice(stream->pipe_fds[0], NULL, out, to_sink ? &stream->sink_off : NULL, len,
+                   SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+        if (n > 0) {
+            stream->stat->spliced += n;
+        }
+    } else {
+        n = to_sink ? pwrite(out, stream->buf + stream->buf_off, len, stream->sink_off)
+                    : send(out, stream->buf + stream->buf_off, len, MSG_NOSIGNAL);
+        if (n > 0 && to_sink) {
+            stream->sink_off += n;
+        }
+        if (n > 0) {
+            stream->buf_off += n;
+            stream->stat->copied += n;
+        }
+    }
+
+    if (n > 0) {
+        stream->pending -= n;
+    }
+    return n;
+}
+
+ssize_t splice_stream_flush(SpliceStream *stream, int sockfd, size_t limit) {
+    size_t sent = 0;
+    stream->waiting = false;
+
+    while (sent < limit) {
+        ssize_t n;
+        if (stream->framing_off < stream->framing_len) {
+            // 块长度后紧跟数据时合并到同一个 TCP 段
+            int flags = MSG_NOSIGNAL | (stream->pending > 0 ? MSG_MORE : 0);
+            n = send(sockfd, stream->framing + stream->framing_off,
+                     stream->framing_len - stream->framing_off, flags);
+            if (n > 0) {
+                stream->framing_off += n;
+            }
+        } else if (stream->pending > 0) {
+            n = stream_drain(stream, sockfd, limit - sent);
+            if (n > 0 && stream->pending == 0 && stream->chunked) {
+                stream->crlf_due = true;
+            }
+        } else if (stream->eof) {
+            break;
+        } else {
+            n = stream_fill(stream, limit - sent);
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                stream->waiting = true;
+                break;
+            }
+            if (n == 0 && stream->remaining != SIZE_MAX) {
+                // 来源在给定长度之前结束，例如客户端没发完请求体就关闭了写方向
+                errno = ECONNRESET;
+                n = -1;
+            }
+            if (n < 0) {
+                LOG_ERROR("Failed to read %s: %s", stream->stat->path, strerror(errno));
+                return -1;
+            }
+
+            if (n == 0) {
+                stream->eof = true;
+            } else {
+                stream->pending = n;
+                if (stream->remaining != SIZE_MAX) {
+                    stream->remaining -= n;
+                    stream->eof = stream->remaining == 0;
+                }
+            }
+            if (stream->chunked) {
+                set_framing(stream, n);
+            }
+            continue;
+        }
+
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            // socket 已写满：本次发出过数据时正常返回，等待下次可写
+            if ((errno == EAGAIN || errno == EWOULDBLOCK) && sent > 0) {
+                break;
+            }
+            return -1;
+        }
+        sent += n;
+    }
+    return sent;
+}
+
+bool splice_stream_done(const SpliceStream *stream) {
+    return stream->eof && stream->pending == 0 && stream->framing_off == stream->framing_len;
+}
+
+int splice_stream_waiting_fd(const SpliceStream *stream) {
+    return stream->waiting ? stream->fd : -1;
+}
+
+void splice_stream_stats_dump(void) {
+    for (size_t i = 0; i < stat_count; i++) {
+        LOG_INFO("[splice] %s: transfers=%zu spliced=%zu copied=%zu",
+                 stats[i].path, stats[i].transfers, stats[i].spliced, stats[i].copied);
+    }
+}
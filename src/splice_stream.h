@@ -0,0 +1,34 @@
+#ifndef SPLICE_STREAM_H
+#define SPLICE_STREAM_H
+
+#include <stdbool.h>
+#include <sys/types.h>
+
+#define SPLICE_STREAM_CHUNK (64 * 1024)  // 单次从来源读入的上限，与默认管道容量一致
+#define SPLICE_STATS_MAX 64             // 按路径统计的条目上限，超出后计入最后一项
+#define SPLICE_PATH_MAX 256
+
+// 长度未知的响应体（管道、字符设备等），通过 splice 经专用管道从来源 fd 送到 socket，
+// 来源不支持 splice 时回退到 read/send；分块模式下按 HTTP/1.1 chunked 编码发送。
+// 也用于转发 socket 中长度已知的请求体：原样发回客户端，或写入 sink
+typedef struct SpliceStream SpliceStream;
+
+// 接管 fd 的所有权，path 用于按路径统计
+SpliceStream* splice_stream_create(const char *path, int fd, bool chunked);
+// 从 fd 读取恰好 len 字节（如 socket 中剩余的请求体），不接管 fd 的所有权；
+// sink_fd 非负时从 sink_off 起写入 sink_fd，否则原样发往 socket；label 用于统计
+SpliceStream* splice_stream_create_body(const char *label, int fd, size_t len, int sink_fd, off_t sink_off);
+void splice_stream_destroy(SpliceStream *stream);
+
+// 最多向 socket 发送 limit 字节（含分块编码），返回已发送字节数；
+// socket 写满且本次未发出任何数据时返回 -1 并设置 errno 为 EAGAIN，连接出错时返回 -1
+ssize_t splice_stream_flush(SpliceStream *stream, int sockfd, size_t limit);
+// 来源读完且所有数据和结尾都已发出
+bool splice_stream_done(const SpliceStream *stream);
+// 来源暂时没有数据时返回其 fd，调用者应等待它可读而不是 socket 可写；否则返回 -1
+int splice_stream_waiting_fd(const SpliceStream *stream);
+
+// 按路径输出经 splice 和回退路径发送的字节数
+void splice_stream_stats_dump(void);
+
+#endif
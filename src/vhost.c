@@ -0,0 +1,166 @@
+#include "vhost.h"
+#include "mem_stats.h"
+#include "logger.h"
+#include <string.h>
+#include <ctype.h>
+
+// 规范化主机名：去掉端口和末尾的点，转为小写；无效时返回 0
+static size_t normalize_host(const char *host, char *out) {
+    size_t len = 0;
+    const char *end = host + strlen(host);
+
+    // IPv6 字面量保留方括号，只去掉其后的端口
+    const char *colon = host[0] == '[' ? strchr(host, ']') : host;
+    colon = colon ? strchr(colon, ':') : NULL;
+    if (colon) {
+        end = colon;
+    }
+    while (end > host && end[-1] == '.') {
+        end--;
+    }
+    if (end == host || end - host >= VHOST_NAME_MAX) {
+        return 0;
+    }
+    for (const char *p = host; p < end; p++) {
+        out[len++] = tolower((unsigned char)*p);
+    }
+    out[len] = '\0';
+    return len;
+}
+
+static uint32_t hash_name(const char *name) {
+    // FNV-1a
+    uint32_t hash = 2166136261u;
+    for (const unsigned char *p = (const unsigned char *)name; *p; p++) {
+        hash ^= *p;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+static VirtualHost* find_host(const VhostTable *table, const char *name, uint32_t hash) {
+    for (VirtualHost *host = table->buckets[hash & (VHOST_BUCKETS - 1)]; host; host = host->hash_next) {
+        if (host->hash == hash && strcmp(host->name, name) == 0) {
+            return host;
+        }
+    }
+    return NULL;
+}
+
+VhostTable* vhost_table_create(FileCache *default_cache) {
+    VhostTable *table = mem_calloc(MEM_TAG_FILE_CACHE, 1, sizeof(VhostTable));
+    if (!table) {
+        return NULL;
+    }
+    table->default_cache = default_cache;
+    return table;
+}
+
+void vhost_table_destroy(VhostTable *table) {
+    if (!table) {
+        return;
+    }
+
+    VirtualHost *host = table->hosts;
+    while (host) {
+        VirtualHost *next = host->list_next;
+        fingerprint_destroy(host->cache->fingerprints);
+        file_cache_destroy(host->cache);
+        mem_free(host);
+        host = next;
+    }
+    mem_free(table);
+}
+
+int vhost_add(VhostTable *table, const char *name, const char *root, size_t cache_size,
+              OpenFileCache *open_files) {
+    char key[VHOST_NAME_MAX];
+    size_t len = normalize_host(name, key);
+    if (len == 0) {
+        LOG_ERROR("Invalid virtual host name: %s", name);
+        return -1;
+    }
+    uint32_t hash = hash_name(key);
+    if (find_host(table, key, hash)) {
+        LOG_ERROR("Duplicate virtual host: %s", key);
+        return -1;
+    }
+
+    VirtualHost *host = mem_calloc(MEM_TAG_FILE_CACHE, 1, sizeof(VirtualHost) + len + 1);
+    if (!host) {
+        return -1;
+    }
+    host->name = (char *)(host + 1);
+    memcpy(host->name, key, len + 1);
+    host->hash = hash;
+
+    host->cache = file_cache_create(root, cache_size, open_files);
+    if (!host->cache) {
+        LOG_ERROR("Failed to create file cache for virtual host %s", key);
+        mem_free(host);
+        return -1;
+    }
+    // 压缩变体以文件路径为键，各站点的路径不会重叠，可以共用
+    host->cache->gzip = table->default_cache->gzip;
+    host->cache->prefetch = table->default_cache->prefetch;
+    if (file_cache_watch(host->cache) == 0) {
+        host->cache->fingerprints = fingerprint_build(root, NULL);
+    }
+
+    size_t b = hash & (VHOST_BUCKETS - 1);
+    host->hash_next = table->buckets[b];
+    table->buckets[b] = host;
+    host->list_next = table->hosts;
+    table->hosts = host;
+    table->count++;
+    LOG_INFO("Virtual host %s -> %s", key, root);
+    return 0;
+}
+
+FileCache* vhost_lookup(VhostTable *table, const char *host) {
+    char key[VHOST_NAME_MAX];
+    if (table->count > 0 && host && normalize_host(host, key) > 0) {
+        VirtualHost *found = find_host(table, key, hash_name(key));
+        if (found) {
+            found->requests++;
+            return found->cache;
+        }
+    }
+    table->default_requests++;
+    return table->default_cache;
+}
+
+int vhost_watch_fds(const VhostTable *table, fd_set *fds, int max_fd) {
+    for (VirtualHost *host = table->hosts; host; host = host->list_next) {
+        int fd = file_cache_fd(host->cache);
+        if (fd >= 0) {
+            FD_SET(fd, fds);
+            if (fd > max_fd) {
+                max_fd = fd;
+            }
+        }
+    }
+    return max_fd;
+}
+
+void vhost_process_events(VhostTable *table, const fd_set *fds) {
+    for (VirtualHost *host = table->hosts; host; host = host->list_next) {
+        int fd = file_cache_fd(host->cache);
+        if (fd >= 0 && FD_ISSET(fd, fds)) {
+            file_cache_process_events(host->cache);
+        }
+    }
+}
+
+void vhost_dump(const VhostTable *table) {
+    if (!table) {
+        return;
+    }
+
+    LOG_INFO("Virtual hosts: %zu, default site requests: %zu", table->count, table->default_requests);
+    for (const VirtualHost *host = table->hosts; host; host = host->list_next) {
+        LOG_INFO("Virtual host [%s] requests: %zu", host->name, host->requests);
+        file_cache_dump(host->cache);
+        fingerprint_dump(host->cache->fingerprints);
+    }
+}
@@ -0,0 +1,51 @@
+#ifndef VHOST_H
+#define VHOST_H
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <sys/select.h>
+#include "file_cache.h"
+
+#define VHOST_BUCKETS 64
+#define VHOST_NAME_MAX 256
+
+// 按 Host 头选择的虚拟主机，各自有文档根目录、文件缓存和指纹索引
+typedef struct VirtualHost {
+    char *name;                 // 小写且不含端口的主机名
+    FileCache *cache;           // 由虚拟主机持有，root 即文档根目录
+    uint32_t hash;
+    size_t requests;
+    struct VirtualHost *hash_next;
+    struct VirtualHost *list_next;
+} VirtualHost;
+
+// 虚拟主机表；Host 头缺失或未配置时使用默认站点
+typedef struct VhostTable {
+    VirtualHost *buckets[VHOST_BUCKETS];
+    VirtualHost *hosts;         // 所有虚拟主机，用于监视文件变化和输出统计
+    size_t count;
+    FileCache *default_cache;   // 默认站点的缓存，不由表持有
+
+    // 统计
+    size_t default_requests;
+} VhostTable;
+
+VhostTable* vhost_table_create(FileCache *default_cache);
+void vhost_table_destroy(VhostTable *table);
+
+// 添加虚拟主机：为 root 创建独立预算的文件缓存和指纹索引，
+// 打开文件缓存、压缩变体缓存和预读线程与默认站点共用；主机名重复时返回 -1
+int vhost_add(VhostTable *table, const char *name, const char *root, size_t cache_size,
+              OpenFileCache *open_files);
+
+// 按 Host 头的值查找站点的缓存，忽略大小写和端口；未找到时返回默认站点
+FileCache* vhost_lookup(VhostTable *table, const char *host);
+
+// 把各虚拟主机缓存的 inotify fd 加入 fds，返回更新后的最大 fd
+int vhost_watch_fds(const VhostTable *table, fd_set *fds, int max_fd);
+// 处理 fds 中可读的 inotify 事件
+void vhost_process_events(VhostTable *table, const fd_set *fds);
+
+void vhost_dump(const VhostTable *table);
+
+#endif
@@ -65,6 +65,7 @@
 #line 7 "src/parser.y" /* yacc.c:339  */
 
 #include "parse.h"
+#include "mem_stats.h"
 
 /* Define YACCDEBUG to enable debug messages for this lex file */
 #define YACCDEBUG
@@ -171,7 +172,7 @@ extern int yydebug;
 
 union YYSTYPE
 {
-#line 50 "src/parser.y" /* yacc.c:355  */
+#line 51 "src/parser.y" /* yacc.c:355  */
 
 	char str[8192];
 	int i;
@@ -1286,7 +1287,7 @@ yyreduce:
   switch (yyn)
     {
         case 3:
-#line 114 "src/parser.y" /* yacc.c:1646  */
+#line 115 "src/parser.y" /* yacc.c:1646  */
     {
 	(yyval.i) = '0' + (yyvsp[0].i);
 }
@@ -1294,7 +1295,7 @@ yyreduce:
     break;
 
   case 5:
-#line 123 "src/parser.y" /* yacc.c:1646  */
+#line 124 "src/parser.y" /* yacc.c:1646  */
     {
 	// YPRINTF("token: Matched rule 1.\n");
 	snprintf((yyval.str), 8192, "%c", (yyvsp[0].i));
@@ -1303,7 +1304,7 @@ yyreduce:
     break;
 
   case 6:
-#line 127 "src/parser.y" /* yacc.c:1646  */
+#line 128 "src/parser.y" /* yacc.c:1646  */
     {
 	// YPRINTF("token: Matched rule 2.\n");
 	memcpy((yyval.str), (yyvsp[-1].str), strlen((yyvsp[-1].str)));
@@ -1315,7 +1316,7 @@ yyreduce:
     break;
 
   case 8:
-#line 157 "src/parser.y" /* yacc.c:1646  */
+#line 158 "src/parser.y" /* yacc.c:1646  */
     {
 	(yyval.i) = (yyvsp[0].i);
 }
@@ -1323,7 +1324,7 @@ yyreduce:
     break;
 
   case 9:
-#line 160 "src/parser.y" /* yacc.c:1646  */
+#line 161 "src/parser.y" /* yacc.c:1646  */
     {
 	(yyval.i) = (yyvsp[0].i);
 }
@@ -1331,7 +1332,7 @@ yyreduce:
     break;
 
   case 10:
-#line 163 "src/parser.y" /* yacc.c:1646  */
+#line 164 "src/parser.y" /* yacc.c:1646  */
     {
 	(yyval.i) = (yyvsp[0].i);
 }
@@ -1339,7 +1340,7 @@ yyreduce:
     break;
 
   case 11:
-#line 171 "src/parser.y" /* yacc.c:1646  */
+#line 172 "src/parser.y" /* yacc.c:1646  */
     {
 	// YPRINTF("text: Matched rule 1.\n");
 	snprintf((yyval.str), 8192, "%c", (yyvsp[0].i));
@@ -1348,7 +1349,7 @@ yyreduce:
     break;
 
   case 12:
-#line 175 "src/parser.y" /* yacc.c:1646  */
+#line 176 "src/parser.y" /* yacc.c:1646  */
     {
 	// YPRINTF("text: Matched rule 2.\n");
 	memcpy((yyval.str), (yyvsp[-2].str), strlen((yyvsp[-2].str)));
@@ -1361,7 +1362,7 @@ yyreduce:
     break;
 
   case 13:
-#line 187 "src/parser.y" /* yacc.c:1646  */
+#line 188 "src/parser.y" /* yacc.c:1646  */
     {
 	// YPRINTF("OWS: Matched rule 1\n");
 	(yyval.str)[0]=0;
@@ -1370,7 +1371,7 @@ yyreduce:
     break;
 
   case 14:
-#line 191 "src/parser.y" /* yacc.c:1646  */
+#line 192 "src/parser.y" /* yacc.c:1646  */
     {
 	// YPRINTF("OWS: Matched rule 2\n");
 	snprintf((yyval.str), 8192, "%c", (yyvsp[0].i));
@@ -1379,7 +1380,7 @@ yyreduce:
     break;
 
   case 15:
-#line 195 "src/parser.y" /* yacc.c:1646  */
+#line 196 "src/parser.y" /* yacc.c:1646  */
     {
 	// YPRINTF("OWS: Matched rule 3\n");
 	snprintf((yyval.str), 8192, "%s", (yyvsp[0].str));
@@ -1388,7 +1389,7 @@ yyreduce:
     break;
 
   case 16:
-#line 200 "src/parser.y" /* yacc.c:1646  */
+#line 201 "src/parser.y" /* yacc.c:1646  */
     {
 	// YPRINTF("request_Line:\n%s\n%s\n%s\n",$1, $3,$5);
     strcpy(parsing_request->http_method, (yyvsp[-5].str));
@@ -1399,12 +1400,12 @@ yyreduce:
     break;
 
   case 17:
-#line 207 "src/parser.y" /* yacc.c:1646  */
+#line 208 "src/parser.y" /* yacc.c:1646  */
     {
 	// YPRINTF("request_Header:\n%s\n%s\n",$1,$5);
 	if (parsing_request->header_count == parsing_request->header_capacity){
         parsing_request->header_capacity *= 2 ;
-        if ((parsing_request->headers = (Request_header *) realloc(parsing_request->headers, 
+        if ((parsing_request->headers = (Request_header *) mem_realloc(MEM_TAG_REQUEST, parsing_request->headers, 
              sizeof(Request_header) * parsing_request->header_capacity)) == NULL){
             yyerror ("Can not allocate memory for HTTP request headers.") ;
             return -1 ;
@@ -1418,19 +1419,19 @@ yyreduce:
     break;
 
   case 18:
-#line 230 "src/parser.y" /* yacc.c:1646  */
+#line 231 "src/parser.y" /* yacc.c:1646  */
     {}
 #line 1424 "y.tab.c" /* yacc.c:1646  */
     break;
 
   case 19:
-#line 231 "src/parser.y" /* yacc.c:1646  */
+#line 232 "src/parser.y" /* yacc.c:1646  */
     {}
 #line 1430 "y.tab.c" /* yacc.c:1646  */
     break;
 
   case 20:
-#line 233 "src/parser.y" /* yacc.c:1646  */
+#line 234 "src/parser.y" /* yacc.c:1646  */
     {
 	// YPRINTF("parsing_request: Matched Success.\n");
 	return SUCCESS;
@@ -1667,7 +1668,7 @@ yyreturn:
 #endif
   return yyresult;
 }
-#line 238 "src/parser.y" /* yacc.c:1906  */
+#line 239 "src/parser.y" /* yacc.c:1906  */
 
 
 /* C code */
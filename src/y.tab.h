@@ -78,7 +78,7 @@ extern int yydebug;
 
 union YYSTYPE
 {
-#line 50 "src/parser.y" /* yacc.c:1909  */
+#line 51 "src/parser.y" /* yacc.c:1909  */
 
 	char str[8192];
 	int i;